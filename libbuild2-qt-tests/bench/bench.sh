@@ -0,0 +1,151 @@
+#!/usr/bin/env bash
+
+# Benchmark the Qt compilers build system module on a synthetic project (see
+# README.md for details).
+#
+# Generate the project in the specified directory (unless it already exists),
+# configure it with the specified configuration variables, and measure the
+# wall time and the peak memory of the following builds:
+#
+# full     -- build from scratch
+# noop     -- build with nothing changed
+# touch    -- build after touching one header that contains Q_OBJECT
+# options  -- build after changing qt.moc.options (via config.qt.moc.options)
+#
+# -b <path>
+#    The build system driver to use, b by default.
+#
+# -j <n>
+#    Number of jobs to run in parallel (passed to the build system driver).
+#
+# -h|-q|-c|-u|-r|-f|-s|-v <value>
+#    Passed to generate.sh.
+#
+usage="usage: $0 [<options>] <dir> [<config-var>...]"
+
+owd="$(pwd)"
+trap "{ cd '$owd'; exit 1; }" ERR
+set -o errtrace # Trap in functions and subshells.
+set -o pipefail # Fail if any pipeline command fails.
+shopt -s lastpipe # Execute last pipeline command in the current shell.
+
+function info () { echo "$*" 1>&2; }
+function error () { info "$*"; exit 1; }
+
+b=b
+bopts=()
+gopts=()
+dir=
+cfg=()
+
+while [ "$#" -gt 0 ]; do
+  case "$1" in
+    -b) shift; b="$1"; shift ;;
+    -j) shift; bopts+=(-j "$1"); shift ;;
+    -h|-q|-c|-u|-r|-f|-s|-v) gopts+=("$1" "$2"); shift 2 ;;
+    -*) error "unknown option $1" ;;
+    *)
+      if [ -z "$dir" ]; then
+        dir="${1%/}"
+      else
+        cfg+=("$1")
+      fi
+      shift
+      ;;
+  esac
+done
+
+if [ -z "$dir" ]; then
+  error "$usage"
+fi
+
+if [ -z "$EPOCHREALTIME" ]; then
+  error "bash 5.0 or later is required"
+fi
+
+if [ ! -d "$dir" ]; then
+  "$(dirname "$0")/generate.sh" "${gopts[@]}" "$dir"
+fi
+
+dir="$(cd "$dir" && pwd)"
+log="$dir/bench.log"
+
+# Determine how to measure the peak memory. Note that this is the peak
+# resident set size of the build system driver or any of the processes it
+# runs (whichever is the largest) rather than their sum.
+#
+time=
+if /usr/bin/time --version 2>&1 | grep -q GNU; then
+  time=gnu
+elif [ "$(uname)" = "Darwin" ]; then
+  time=bsd
+fi
+
+# Run the build system driver with the specified arguments and print the
+# wall time and the peak memory.
+#
+function measure () # <step> <arg>...
+{
+  local step="$1"
+  shift
+
+  local rss=- s e
+
+  echo "=== $step: $b ${bopts[*]} $*" >>"$log"
+
+  s="${EPOCHREALTIME/[.,]/}"
+
+  case "$time" in
+    gnu)
+      /usr/bin/time -f '%M' -o "$dir/bench.rss" \
+                    "$b" "${bopts[@]}" "$@" >>"$log" 2>&1
+      rss="$(( $(tail -n 1 "$dir/bench.rss") / 1024 ))"
+      ;;
+    bsd)
+      /usr/bin/time -l "$b" "${bopts[@]}" "$@" >>"$log" 2>"$dir/bench.rss"
+      cat "$dir/bench.rss" >>"$log"
+      rss="$(sed -n -e 's/^ *\([0-9]*\) *maximum resident set size$/\1/p' \
+                 "$dir/bench.rss")"
+      rss="$(( rss / 1024 / 1024 ))"
+      ;;
+    *)
+      "$b" "${bopts[@]}" "$@" >>"$log" 2>&1
+      ;;
+  esac
+
+  e="${EPOCHREALTIME/[.,]/}"
+
+  local us="$(( e - s ))"
+  printf "%-8s %8d.%03d %12s\n" "$step" \
+         "$(( us / 1000000 ))" "$(( (us / 1000) % 1000 ))" "$rss"
+}
+
+: >"$log"
+
+"$b" configure: "$dir/" "${cfg[@]}" >>"$log" 2>&1
+"$b" clean: "$dir/" >>"$log" 2>&1
+
+printf "%-8s %12s %12s\n" "step" "time (s)" "peak RSS (MB)"
+
+measure full "update:" "$dir/"
+measure noop "update:" "$dir/"
+
+for h in "$dir"/bench/h*.hxx; do
+  if grep -q Q_OBJECT "$h"; then
+    touch "$h"
+    measure touch "update:" "$dir/"
+    break
+  fi
+done
+
+measure options "update:" "$dir/" \
+        "config.qt.moc.options=-DBENCH_OPTION_CHANGE"
+
+# Restore the original options so that the next run starts from a consistent
+# state (not measured).
+#
+"$b" "${bopts[@]}" update: "$dir/" >>"$log" 2>&1
+
+rm -f "$dir/bench.rss"
+
+info "build log written to $log"
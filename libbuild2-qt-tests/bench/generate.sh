@@ -0,0 +1,329 @@
+#!/usr/bin/env bash
+
+# Generate a synthetic Qt project for benchmarking the Qt compilers build
+# system module (see README.md for details).
+#
+# -h <n>
+#    Number of headers (and corresponding source files) to generate, 1000 by
+#    default.
+#
+# -q <percent>
+#    Percentage of headers that contain the Q_OBJECT macro, 50 by default.
+#
+# -c <lines>
+#    Number of comment lines in each header, 20 by default.
+#
+# -u <n>
+#    Number of .ui files to generate, 50 by default.
+#
+# -r <n>
+#    Number of .qrc files to generate, 4 by default.
+#
+# -f <n>
+#    Number of resources in each .qrc file, 250 by default.
+#
+# -s <bytes>
+#    Size of each resource, 4096 by default.
+#
+# -v <version>
+#    Qt version to use (5 or 6), 6 by default.
+#
+usage="usage: $0 [<options>] <dir>"
+
+owd="$(pwd)"
+trap "{ cd '$owd'; exit 1; }" ERR
+set -o errtrace # Trap in functions and subshells.
+set -o pipefail # Fail if any pipeline command fails.
+shopt -s lastpipe # Execute last pipeline command in the current shell.
+
+function info () { echo "$*" 1>&2; }
+function error () { info "$*"; exit 1; }
+
+headers=1000
+qobject=50
+comments=20
+uis=50
+qrcs=4
+resources=250
+resource_size=4096
+qt=6
+dir=
+
+while [ "$#" -gt 0 ]; do
+  case "$1" in
+    -h) shift; headers="$1";       shift ;;
+    -q) shift; qobject="$1";       shift ;;
+    -c) shift; comments="$1";      shift ;;
+    -u) shift; uis="$1";           shift ;;
+    -r) shift; qrcs="$1";          shift ;;
+    -f) shift; resources="$1";     shift ;;
+    -s) shift; resource_size="$1"; shift ;;
+    -v) shift; qt="$1";            shift ;;
+    -*) error "unknown option $1" ;;
+    *)
+      if [ -n "$dir" ]; then
+        error "$usage"
+      fi
+      dir="${1%/}"
+      shift
+      ;;
+  esac
+done
+
+if [ -z "$dir" ]; then
+  error "$usage"
+fi
+
+if [ "$qt" != 5 -a "$qt" != 6 ]; then
+  error "invalid Qt version $qt"
+fi
+
+if [ -e "$dir" ]; then
+  error "$dir already exists"
+fi
+
+mkdir -p "$dir/build" "$dir/bench"
+
+# Return 0 if the header with the specified number should contain Q_OBJECT.
+# Spread such headers evenly rather than putting them all first.
+#
+function has_qobject () # <n>
+{
+  [ $(( ($1 * qobject) / 100 )) -ne $(( (($1 + 1) * qobject) / 100 )) ]
+}
+
+cat <<EOF >"$dir/build/bootstrap.build"
+project = qt-bench
+
+using config
+EOF
+
+cat <<EOF >"$dir/build/root.build"
+cxx.std = latest
+
+using cxx
+
+hxx{*}: extension = hxx
+cxx{*}: extension = cxx
+
+qt.version = $qt
+
+using qt.moc
+using qt.uic
+using qt.rcc
+EOF
+
+# The headers, source files, and moc inputs.
+#
+for ((i=0; i != headers; i++)); do
+  {
+    echo "#pragma once"
+    echo
+    echo "#include <QObject>"
+    echo
+    echo "namespace bench"
+    echo "{"
+
+    for ((j=0; j != comments; j++)); do
+      echo "  // Lorem ipsum dolor sit amet, consectetur adipiscing elit $j."
+    done
+    echo "  //"
+
+    if has_qobject "$i"; then
+      cat <<EOF
+  class c$i: public QObject
+  {
+    Q_OBJECT
+
+  public:
+    explicit
+    c$i (QObject* p = nullptr): QObject (p) {}
+
+    int
+    value () const;
+
+  signals:
+    void
+    changed (int);
+
+  public slots:
+    void
+    set (int);
+
+  private:
+    int value_ = 0;
+  };
+}
+EOF
+    else
+      cat <<EOF
+  class c$i
+  {
+  public:
+    int
+    value () const;
+
+    void
+    set (int);
+
+  private:
+    int value_ = 0;
+  };
+}
+EOF
+    fi
+  } >"$dir/bench/h$i.hxx"
+
+  {
+    echo "#include <bench/h$i.hxx>"
+    echo
+    echo "namespace bench"
+    echo "{"
+    echo "  int c$i::"
+    echo "  value () const"
+    echo "  {"
+    echo "    return value_;"
+    echo "  }"
+    echo
+    echo "  void c$i::"
+    echo "  set (int v)"
+    echo "  {"
+
+    if has_qobject "$i"; then
+      echo "    if (value_ != v)"
+      echo "    {"
+      echo "      value_ = v;"
+      echo "      emit changed (v);"
+      echo "    }"
+    else
+      echo "    value_ = v;"
+    fi
+
+    echo "  }"
+    echo "}"
+  } >"$dir/bench/h$i.cxx"
+done
+
+# The .ui files and the source files that use the uic outputs.
+#
+for ((i=0; i != uis; i++)); do
+  cat <<EOF >"$dir/bench/form$i.ui"
+<?xml version="1.0" encoding="UTF-8"?>
+<ui version="4.0">
+ <class>Form$i</class>
+ <widget class="QWidget" name="Form$i">
+  <property name="windowTitle">
+   <string>Form $i</string>
+  </property>
+  <layout class="QVBoxLayout" name="layout">
+   <item>
+    <widget class="QLabel" name="label">
+     <property name="text">
+      <string>Label $i</string>
+     </property>
+    </widget>
+   </item>
+   <item>
+    <widget class="QPushButton" name="button">
+     <property name="text">
+      <string>Button $i</string>
+     </property>
+    </widget>
+   </item>
+  </layout>
+ </widget>
+ <resources/>
+ <connections/>
+</ui>
+EOF
+
+  cat <<EOF >"$dir/bench/form$i.cxx"
+#include <QWidget>
+
+#include <bench/ui_form$i.hxx>
+
+namespace bench
+{
+  void
+  setup_form$i (QWidget* w)
+  {
+    Ui::Form$i f;
+    f.setupUi (w);
+  }
+}
+EOF
+done
+
+# The .qrc files and their resources.
+#
+for ((i=0; i != qrcs; i++)); do
+  mkdir -p "$dir/bench/res$i"
+
+  {
+    echo "<RCC>"
+    echo "  <qresource prefix=\"/res$i\">"
+
+    for ((j=0; j != resources; j++)); do
+      echo "    <file>res$i/r$j.txt</file>"
+
+      # Make the content differ between resources so that rcc cannot share
+      # the data.
+      #
+      yes "resource $i/$j" | head -c "$resource_size" \
+        >"$dir/bench/res$i/r$j.txt" || true
+    done
+
+    echo "  </qresource>"
+    echo "</RCC>"
+  } >"$dir/bench/res$i.qrc"
+done
+
+cat <<EOF >"$dir/bench/driver.cxx"
+int
+main ()
+{
+  return 0;
+}
+EOF
+
+# The buildfiles.
+#
+cat <<EOF >"$dir/buildfile"
+./: bench/
+EOF
+
+{
+  cat <<EOF
+import libs  = libQt${qt}Core%lib{Qt${qt}Core}
+import libs += libQt${qt}Widgets%lib{Qt${qt}Widgets}
+
+src = hxx{h*} cxx{h* form* driver}
+
+exe{bench}: \$src automoc{bench} libue{meta}
+
+automoc{bench}: hxx{h*} libue{meta}
+
+libue{meta}: \$libs
+
+EOF
+
+  for ((i=0; i != uis; i++)); do
+    echo "exe{bench}: hxx{ui_form$i}"
+    echo "hxx{ui_form$i}: ui{form$i}"
+  done
+
+  for ((i=0; i != qrcs; i++)); do
+    echo "exe{bench}: cxx{qrc_res$i}"
+    echo "cxx{qrc_res$i}: qrc{res$i}"
+  done
+
+  cat <<EOF
+
+qt.moc.options += -p bench
+
+cxx.poptions =+ "-I\$out_root" "-I\$src_root"
+EOF
+} >"$dir/bench/buildfile"
+
+info "generated $headers headers ($qobject% with Q_OBJECT), $uis .ui files," \
+     "$qrcs .qrc files with $resources resources each in $dir/"
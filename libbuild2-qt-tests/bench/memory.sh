@@ -0,0 +1,156 @@
+#!/usr/bin/env bash
+
+# Measure the memory used by the automoc{} rule per input (see README.md for
+# details).
+#
+# For each of the specified numbers of headers generate a project in the
+# specified directory (unless it already exists) using generate.sh (without
+# any .ui or .qrc files), configure it with the specified configuration
+# variables, and measure the peak memory of matching its automoc{} group
+# (which includes scanning the inputs and synthesizing and matching the moc
+# output targets) from scratch (cold) and with the scan results already in
+# the depdb (warm). Print the peak memory and the increase of the peak memory
+# per input compared to the previous number of headers.
+#
+# -b <path>
+#    The build system driver to use, b by default.
+#
+# -j <n>
+#    Number of jobs to run in parallel (passed to the build system driver).
+#
+# -n <n>
+#    Number of headers, can be specified multiple times, 2000, 8000, and
+#    32000 by default.
+#
+# -v <version>
+#    Passed to generate.sh.
+#
+usage="usage: $0 [<options>] <dir> [<config-var>...]"
+
+owd="$(pwd)"
+trap "{ cd '$owd'; exit 1; }" ERR
+set -o errtrace # Trap in functions and subshells.
+set -o pipefail # Fail if any pipeline command fails.
+shopt -s lastpipe # Execute last pipeline command in the current shell.
+
+function info () { echo "$*" 1>&2; }
+function error () { info "$*"; exit 1; }
+
+b=b
+bopts=()
+gopts=()
+sizes=()
+dir=
+cfg=()
+
+while [ "$#" -gt 0 ]; do
+  case "$1" in
+    -b) shift; b="$1"; shift ;;
+    -j) shift; bopts+=(-j "$1"); shift ;;
+    -n) shift; sizes+=("$1"); shift ;;
+    -v) gopts+=("$1" "$2"); shift 2 ;;
+    -*) error "unknown option $1" ;;
+    *)
+      if [ -z "$dir" ]; then
+        dir="${1%/}"
+      else
+        cfg+=("$1")
+      fi
+      shift
+      ;;
+  esac
+done
+
+if [ -z "$dir" ]; then
+  error "$usage"
+fi
+
+if [ "${#sizes[@]}" -eq 0 ]; then
+  sizes=(2000 8000 32000)
+fi
+
+# Note that unlike bench.sh we need the peak memory of the build system
+# driver itself, which is what we get in the match-only mode since no
+# compilers are executed.
+#
+time=
+if /usr/bin/time --version 2>&1 | grep -q GNU; then
+  time=gnu
+elif [ "$(uname)" = "Darwin" ]; then
+  time=bsd
+else
+  error "GNU time or Mac OS /usr/bin/time is required"
+fi
+
+mkdir -p "$dir"
+dir="$(cd "$dir" && pwd)"
+log="$dir/memory.log"
+
+# Match the automoc{} group of the project in the specified directory and
+# print the peak memory in KB.
+#
+function measure () # <dir>
+{
+  local t="$1/bench/automoc{bench}"
+
+  echo "=== $b ${bopts[*]} --match-only update: $t" >>"$log"
+
+  case "$time" in
+    gnu)
+      /usr/bin/time -f '%M' -o "$dir/memory.rss" \
+                    "$b" "${bopts[@]}" --match-only "update: $t" \
+                    >>"$log" 2>&1
+      tail -n 1 "$dir/memory.rss"
+      ;;
+    bsd)
+      /usr/bin/time -l "$b" "${bopts[@]}" --match-only "update: $t" \
+                    >>"$log" 2>"$dir/memory.rss"
+      cat "$dir/memory.rss" >>"$log"
+      echo "$(( $(sed -n -e \
+                  's/^ *\([0-9]*\) *maximum resident set size$/\1/p' \
+                  "$dir/memory.rss") / 1024 ))"
+      ;;
+  esac
+}
+
+: >"$log"
+
+printf "%-8s %14s %10s %14s %10s\n" \
+       "inputs" "cold RSS (MB)" "B/input" "warm RSS (MB)" "B/input"
+
+pn=
+pc=
+pw=
+
+for n in "${sizes[@]}"; do
+  d="$dir/h$n"
+
+  if [ ! -d "$d" ]; then
+    "$(dirname "$0")/generate.sh" "${gopts[@]}" -h "$n" -u 0 -r 0 "$d" \
+      2>>"$log"
+  fi
+
+  "$b" configure: "$d/" "${cfg[@]}" >>"$log" 2>&1
+  "$b" clean: "$d/" >>"$log" 2>&1
+
+  c="$(measure "$d")"
+  w="$(measure "$d")"
+
+  cb=-
+  wb=-
+  if [ -n "$pn" ]; then
+    cb="$(( (c - pc) * 1024 / (n - pn) ))"
+    wb="$(( (w - pw) * 1024 / (n - pn) ))"
+  fi
+
+  printf "%-8s %14d %10s %14d %10s\n" \
+         "$n" "$(( c / 1024 ))" "$cb" "$(( w / 1024 ))" "$wb"
+
+  pn="$n"
+  pc="$c"
+  pw="$w"
+done
+
+rm -f "$dir/memory.rss"
+
+info "build log written to $log"
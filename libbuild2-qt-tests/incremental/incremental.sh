@@ -0,0 +1,561 @@
+#!/usr/bin/env bash
+
+# Verify that incremental builds of a synthetic Qt project are minimal (see
+# README.md for details).
+#
+# Generate a small project in the src/ subdirectory of the specified
+# directory (which must not exist) using ../bench/generate.sh, extend it with
+# a few targets exercising the optional functionality, configure it in the
+# out/ subdirectory with the specified configuration variables, build it, and
+# then apply a sequence of edits verifying after each that the exact expected
+# set of moc, uic, and rcc runs, metatypes collections, and C++ compilations
+# is performed (and, for some edits, that the outputs are as expected). Exit
+# with non-zero status if any step performs more (or less) work than
+# expected.
+#
+# -b <path>
+#    The build system driver to use, b by default.
+#
+# -j <n>
+#    Number of jobs to run in parallel (passed to the build system driver).
+#
+# -k
+#    Keep going after a step fails.
+#
+# -v <version>
+#    Qt version to use (5 or 6), 6 by default.
+#
+usage="usage: $0 [<options>] <dir> [<config-var>...]"
+
+owd="$(pwd)"
+trap "{ cd '$owd'; exit 1; }" ERR
+set -o errtrace # Trap in functions and subshells.
+set -o pipefail # Fail if any pipeline command fails.
+shopt -s lastpipe # Execute last pipeline command in the current shell.
+
+function info () { echo "$*" 1>&2; }
+function error () { info "$*"; exit 1; }
+
+b=b
+bopts=()
+keep=
+qt=6
+dir=
+cfg=()
+
+while [ "$#" -gt 0 ]; do
+  case "$1" in
+    -b) shift; b="$1"; shift ;;
+    -j) shift; bopts+=(-j "$1"); shift ;;
+    -k) keep=true; shift ;;
+    -v) shift; qt="$1"; shift ;;
+    -*) error "unknown option $1" ;;
+    *)
+      if [ -z "$dir" ]; then
+        dir="${1%/}"
+      else
+        cfg+=("$1")
+      fi
+      shift
+      ;;
+  esac
+done
+
+if [ -z "$dir" ]; then
+  error "$usage"
+fi
+
+# Note: with 50% of headers containing Q_OBJECT, the odd-numbered ones do
+# (see has_qobject() in generate.sh).
+#
+headers=8
+
+"$(dirname "$0")/../bench/generate.sh" -v "$qt" \
+  -h "$headers" -q 50 -c 5 -u 2 -r 1 -f 2 -s 64 "$dir/src"
+
+dir="$(cd "$dir" && pwd)"
+src="$dir/src/bench"
+out="$dir/out/bench"
+log="$dir/incremental.log"
+
+# Collect the metatypes of the automoc{} members.
+#
+cat <<EOF >>"$src/buildfile"
+
+./: exe{bench} metatypes{types}
+
+automoc{bench}: qt.moc.output_json = true
+
+metatypes{types}: automoc{bench}
+EOF
+
+# An explicitly declared moc output with the prefilter enabled for a header
+# without any meta-object macros.
+#
+cat <<EOF >"$src/p0.hxx"
+#pragma once
+
+namespace bench
+{
+  class p0
+  {
+  public:
+    int value = 0;
+  };
+}
+EOF
+
+cat <<EOF >>"$src/buildfile"
+
+exe{bench}: cxx{moc_p0}
+
+cxx{moc_p0}: hxx{p0} libue{meta}
+cxx{moc_p0}: qt.moc.prefilter = true
+EOF
+
+# A separate automoc{} group with a generated input that is cleaned without
+# matching the inputs (and which is thus not cleaned unless the depdb is of
+# the earlier version).
+#
+cat <<EOF >"$src/gen.hxx.in"
+#pragma once
+
+#include <QObject>
+
+namespace bench
+{
+  class gen: public QObject
+  {
+    Q_OBJECT
+  };
+}
+EOF
+
+cat <<EOF >>"$src/buildfile"
+
+exe{bench}: automoc{gen}
+
+hxx{gen}: in{gen}
+
+automoc{gen}: hxx{gen} libue{meta}
+automoc{gen}: qt.moc.automoc_clean_inputs = false
+EOF
+
+echo "using in" >>"$dir/src/build/root.build"
+
+# For updating in several operations of the same build system invocation.
+#
+echo "using test" >>"$dir/src/build/bootstrap.build"
+
+: >"$log"
+
+"$b" configure: "$dir/src/@$dir/out/" "${cfg[@]}" >>"$log" 2>&1
+
+# Run the build system driver with the specified arguments and print the
+# work it performed, one line per moc, uic, rcc, or C++ compiler run or
+# metatypes collection, in the '<tool> <name>' form, sorted. The name is the
+# input target name (output for collection) without the directory and
+# extension (for example, 'moc h1', 'c++ moc_h1', or 'collect types').
+#
+# Note that we rely on the verbosity level 1 diagnostics, which print the
+# input target as the second word. The compiler predefs header runs (c++ -dM)
+# are ignored.
+#
+function work () # <arg>...
+{
+  local o
+
+  o="$("$b" "${bopts[@]}" "$@" 2>&1)" || {
+    echo "$o" >>"$log"
+    error "$b $* failed (see $log for details)"
+  }
+
+  echo "$o" >>"$log"
+
+  echo "$o" | \
+    sed -n -E -e 's/^(moc|uic|rcc|c\+\+|collect) ([^ -][^ ]*).*$/\1 \2/p' | \
+    sed -e 's%^\([^ ]*\) .*/%\1 %' \
+        -e 's/ [^ {]*{/ /' -e 's/}$//' \
+        -e 's/\.[^ .]*$//' | sort
+}
+
+failed=
+
+# Perform the build step and verify that the work it performed matches the
+# expected work, one '<tool> <name>' line per argument.
+#
+function step () # <name> <expected>... -- <arg>...
+{
+  local name="$1"
+  shift
+
+  local exp=()
+  while [ "$1" != "--" ]; do
+    exp+=("$1")
+    shift
+  done
+  shift
+
+  echo "=== $name" >>"$log"
+
+  local e a
+  e="$(for w in "${exp[@]}"; do echo "$w"; done | sort)"
+  a="$(work "$@")"
+
+  if [ "$e" = "$a" ]; then
+    info "$name: ok"
+  else
+    info "$name: FAILED"
+    diff -u --label expected --label actual <(echo "$e") <(echo "$a") \
+      1>&2 || true
+
+    failed=true
+
+    if [ -z "$keep" ]; then
+      exit 1
+    fi
+  fi
+}
+
+# Run the build system driver in the specified directory with the specified
+# arguments at the trace verbosity level saving its output to the specified
+# file.
+#
+function traced () # <dir> <file> <arg>...
+{
+  local d="$1"
+  local f="$2"
+  shift 2
+
+  (cd "$d" && "$b" "${bopts[@]}" --verbose 5 "$@") >"$f" 2>&1 || {
+    cat "$f" >>"$log"
+    error "$b $* failed (see $log for details)"
+  }
+}
+
+# Verify that the command succeeds, failing the same way as step otherwise.
+#
+function check () # <name> <command>...
+{
+  local name="$1"
+  shift
+
+  if "$@"; then
+    info "$name: ok"
+  else
+    info "$name: FAILED"
+
+    failed=true
+
+    if [ -z "$keep" ]; then
+      exit 1
+    fi
+  fi
+}
+
+# Append a line to the file.
+#
+function append () # <file> <line>
+{
+  echo "$2" >>"$1"
+}
+
+# Add Q_GADGET to the class in the header. If requested, keep the file size
+# by removing the first comment line and padding with a comment.
+#
+function add_gadget () # <file> [<keep-size>]
+{
+  local f="$1"
+  local n
+  n="$(stat -c %s "$f")"
+
+  if [ -n "$2" ]; then
+    sed -i -e '0,/Lorem/{/Lorem/d}' "$f"
+  fi
+
+  sed -i -e '0,/^  public:$/s//    Q_GADGET\n\n  public:/' "$f"
+
+  if [ -n "$2" ]; then
+    printf "//%*s\n" "$((n - $(stat -c %s "$f") - 3))" "" >>"$f"
+  fi
+}
+
+# Print the modification time of the file.
+#
+function mtime () # <file>
+{
+  stat -c %y "$1"
+}
+
+# Verify that the metatypes collected incrementally (from the previous
+# result and the changed metatypes files) are the same as those collected
+# from scratch.
+#
+function check_metatypes () # <name>
+{
+  local f="$out/types.json"
+
+  cp "$f" "$f.orig"
+  rm -f "$f" "$f.d"
+
+  step "$1-scratch" "collect types" -- update: "$out/metatypes{types}"
+  check "$1" cmp -s "$f.orig" "$f"
+
+  rm -f "$f.orig"
+}
+
+# Initial build (verified to be a complete build as a sanity check of the
+# output parsing).
+#
+full=()
+for ((i=0; i != headers; i++)); do
+  full+=("c++ h$i")
+  if [ $((i % 2)) -eq 1 ]; then
+    full+=("moc h$i" "c++ moc_h$i")
+  fi
+done
+full+=("uic form0" "uic form1" "c++ form0" "c++ form1")
+full+=("rcc res0" "c++ qrc_res0" "c++ driver")
+full+=("moc p0" "c++ moc_p0" "moc gen" "c++ moc_gen")
+full+=("collect types")
+
+step full "${full[@]}" -- update: "$dir/out/"
+
+# Note that the prefilter prints the same diagnostics as a moc run so check
+# that moc was not run for the header without any meta-object macros by
+# the output it produced instead.
+#
+check prefilter grep -q "moc was not run" "$out/moc_p0.cxx"
+
+step noop -- update: "$dir/out/"
+
+# A no-op update must leave the dependency databases as they were, so a
+# second one must not do any work either (for example, rcc's must still be
+# older than its output).
+#
+step noop-again -- update: "$dir/out/"
+
+# Touching a header with Q_OBJECT reruns its moc and recompiles the files
+# that include it (including the moc output). Its metatypes don't change and
+# so neither do the collected ones.
+#
+mt="$(mtime "$out/types.json")"
+touch "$src/h1.hxx"
+step touch-qobject-header "moc h1" "c++ h1" "c++ moc_h1" -- \
+  update: "$dir/out/"
+check touch-qobject-header-metatypes [ "$(mtime "$out/types.json")" = "$mt" ]
+
+# Touching a header without Q_OBJECT only recompiles its source file.
+#
+touch "$src/h0.hxx"
+step touch-header "c++ h0" -- update: "$dir/out/"
+
+# Comment edits.
+#
+append "$src/h2.hxx" "// Comment."
+step comment-header "c++ h2" -- update: "$dir/out/"
+
+append "$src/h3.hxx" "// Comment."
+step comment-qobject-header "moc h3" "c++ h3" "c++ moc_h3" -- \
+  update: "$dir/out/"
+
+append "$src/h4.cxx" "// Comment."
+step comment-source "c++ h4" -- update: "$dir/out/"
+
+# Changing the metatypes of a header (adding a signal) collects them anew,
+# reusing the rest from the previous result. Do this first for a header in
+# the middle (which shifts the metatypes of the following headers in the
+# result) and then for the first header (which reuses the shifted ones).
+#
+signal='\n\n    void\n    reset ();'
+for i in 3 1; do
+  sed -i -e "s/^    changed (int);\$/&$signal/" "$src/h$i.hxx"
+  step "change-metatypes-h$i" \
+    "moc h$i" "c++ h$i" "c++ moc_h$i" "collect types" -- update: "$dir/out/"
+  check_metatypes "change-metatypes-h$i-merge"
+done
+
+# Changing the moc options reruns moc on all the automoc{} members (and
+# regenerates the prefiltered output) and recompiles their outputs but
+# nothing else. Changing them back does the same.
+#
+moc_all=("moc p0" "c++ moc_p0" "moc gen" "c++ moc_gen")
+for ((i=1; i < headers; i += 2)); do
+  moc_all+=("moc h$i" "c++ moc_h$i")
+done
+
+step moc-options "${moc_all[@]}" -- \
+  update: "$dir/out/" "config.qt.moc.options=-DINCREMENTAL_OPTION_CHANGE"
+
+step moc-options-restore "${moc_all[@]}" -- update: "$dir/out/"
+
+# Adding Q_OBJECT to a header makes it an automoc{} member.
+#
+cp "$src/h0.hxx" "$src/h0.hxx.orig"
+cat <<EOF >"$src/h0.hxx"
+#pragma once
+
+#include <QObject>
+
+namespace bench
+{
+  class c0: public QObject
+  {
+    Q_OBJECT
+
+  public:
+    int
+    value () const;
+
+    void
+    set (int);
+
+  private:
+    int value_ = 0;
+  };
+}
+EOF
+step add-qobject "moc h0" "c++ h0" "c++ moc_h0" "collect types" -- \
+  update: "$dir/out/"
+
+# Removing it removes the header from the group without running moc.
+#
+mv "$src/h0.hxx.orig" "$src/h0.hxx"
+step remove-qobject "c++ h0" "collect types" -- update: "$dir/out/"
+
+# Adding Q_OBJECT to the prefiltered header runs moc on it.
+#
+cat <<EOF >"$src/p0.hxx"
+#pragma once
+
+#include <QObject>
+
+namespace bench
+{
+  class p0: public QObject
+  {
+    Q_OBJECT
+
+  public:
+    int value = 0;
+  };
+}
+EOF
+step add-qobject-prefilter "moc p0" "c++ moc_p0" -- update: "$dir/out/"
+check add-qobject-prefilter-output \
+  grep -q "staticMetaObject" "$out/moc_p0.cxx"
+
+# Adding a new header with Q_OBJECT to the automoc{} group (via the hxx{h*}
+# wildcard) only runs moc on the new header.
+#
+cat <<EOF >"$src/h$headers.hxx"
+#pragma once
+
+#include <QObject>
+
+namespace bench
+{
+  class c$headers: public QObject
+  {
+    Q_OBJECT
+
+  public:
+    explicit
+    c$headers (QObject* p = nullptr): QObject (p) {}
+  };
+}
+EOF
+step add-member "moc h$headers" "c++ moc_h$headers" "collect types" -- \
+  update: "$dir/out/"
+
+# The uic and rcc inputs.
+#
+touch "$src/form0.ui"
+step touch-ui "uic form0" "c++ form0" -- update: "$dir/out/"
+
+append "$src/res0/r0.txt" "resource change"
+step change-resource "rcc res0" "c++ qrc_res0" -- update: "$dir/out/"
+
+# Updating in two operations of the same invocation (update and then
+# update-for-test) carries the members of automoc{bench} over to the second
+# operation but not of automoc{gen} since its (generated) input needs
+# updating.
+#
+trace="$dir/incremental.trace"
+traced "$dir/out/" "$trace" update test
+
+check reuse-members grep -q "reusing .* members of .*automoc{bench}" "$trace"
+check reuse-members-update \
+  [ "$(grep -c "members of .*automoc{gen}" "$trace" || true)" -eq 0 ]
+
+# With a fresh change journal (see config.qt.change_journal) that does not
+# record any changes, a changed resource is not noticed. With the journal
+# stale (that is, with the heartbeat in the past), the modification times are
+# checked as usual.
+#
+journal="$dir/incremental.journal"
+cat <<EOF >"$journal"
+qt.change-journal 1
+start 0
+interval 10
+root $dir/src/
+EOF
+
+append "$src/res0/r1.txt" "resource change"
+
+touch -d '1 hour' "$journal"
+step change-journal-fresh -- \
+  update: "$dir/out/" "config.qt.change_journal=$journal"
+
+touch -d '1 hour ago' "$journal"
+step change-journal-stale "rcc res0" "c++ qrc_res0" -- \
+  update: "$dir/out/" "config.qt.change_journal=$journal"
+
+# Cleaning the automoc{} group without matching the inputs removes its
+# members but not the generated input. Updating it reruns moc.
+#
+step clean-cheap -- clean: "$out/automoc{gen}"
+check clean-cheap-members [ ! -e "$out/moc_gen.cxx" ]
+check clean-cheap-inputs [ -e "$out/gen.hxx" ]
+
+step clean-cheap-update "moc gen" "c++ moc_gen" -- update: "$dir/out/"
+
+# Cleaning the automoc{} group with the depdb of the earlier version (whose
+# input flags don't distinguish between headers and source files) falls back
+# to matching (and thus cleaning) the inputs.
+#
+sed -i -e '1s/ 2$/ 1/' -e '2,$s/^2 /1 /' "$out/gen.automoc.d"
+
+step clean-v1 -- clean: "$out/automoc{gen}"
+check clean-v1-members [ ! -e "$out/moc_gen.cxx" ]
+check clean-v1-inputs [ ! -e "$out/gen.hxx" ]
+
+step clean-v1-update "moc gen" "c++ moc_gen" -- update: "$dir/out/"
+
+# The entries of the project-wide automoc{} input scan cache are only reused
+# if both the modification time and size of the input are unchanged. First
+# change a header keeping its size (the modification time changes).
+#
+add_gadget "$src/h4.hxx" true
+step scan-cache-mtime "moc h4" "c++ h4" "c++ moc_h4" "collect types" -- \
+  update: "$dir/out/"
+
+# Then change a header restoring its modification time (the size changes)
+# and force the rescan of all the inputs (which are then looked up in the
+# cache) by removing the automoc{} group's depdb.
+#
+touch -r "$src/h2.hxx" "$dir/h2.hxx.mtime"
+add_gadget "$src/h2.hxx"
+touch -r "$dir/h2.hxx.mtime" "$src/h2.hxx"
+rm "$out/bench.automoc.d"
+
+step scan-cache-size "moc h2" "c++ moc_h2" "collect types" -- \
+  update: "$dir/out/"
+
+step noop-final -- update: "$dir/out/"
+
+if [ -n "$failed" ]; then
+  error "incremental build verification failed (see $log for details)"
+fi
+
+info "build log written to $log"
@@ -0,0 +1,15 @@
+#include <moc-plugin/plugin.hxx>
+
+#include <cstring> // strcmp()
+#include <cassert>
+
+int
+main ()
+{
+  // Make sure the moc output for the plugin class was compiled and linked.
+  //
+  Plugin p;
+  assert (std::strcmp (p.metaObject ()->className (), "Plugin") == 0);
+
+  return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <QtCore/QObject>
+
+class Plugin: public QObject
+{
+  Q_OBJECT
+  Q_PLUGIN_METADATA (IID "org.build2.qt.test.Plugin" FILE "plugin.json")
+};
@@ -0,0 +1,400 @@
+// Usage: automoc-scan [<options>] <path>...
+//
+// Run the automoc{} meta-object macro scanner over the specified files and
+// directories (scanned recursively for C++ headers and source files) and
+// print the scanning throughput. See README.md for details.
+//
+// --iterations <n>
+//    Scan each file this many times and use the fastest run, 3 by default.
+//
+// --generate <dir>
+//    Generate the synthetic corpus in the specified directory (which must
+//    not exist) and add it to the files being scanned.
+//
+// --size <mb>
+//    Size of the large synthetic headers in MB, 4 by default.
+//
+// --slowest <n>
+//    Number of files with the lowest throughput to print, 5 by default.
+//
+#include <chrono>
+#include <cstring>  // strcmp()
+#include <iostream>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/qt/moc/scanner.hxx>
+
+using namespace std;
+using namespace build2;
+
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Return true if the file looks like a C++ header or source file.
+//
+static bool
+cxx_file (const path& f)
+{
+  const char* e (f.extension_cstring ());
+
+  if (e == nullptr)
+    return false;
+
+  for (const char* x: {"h", "hh", "hpp", "hxx", "h++", "ipp", "ixx", "txx",
+                       "c", "cc", "cpp", "cxx", "c++"})
+  {
+    if (strcmp (e, x) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+// Collect files from the directory recursively.
+//
+static void
+collect (const dir_path& d, paths& r)
+{
+  try
+  {
+    using butl::dir_entry;
+    using butl::dir_iterator;
+    using butl::entry_type;
+
+    for (const dir_entry& de: dir_iterator (d, dir_iterator::ignore_dangling))
+    {
+      path p (d / de.path ());
+
+      switch (de.type ())
+      {
+      case entry_type::directory:
+        collect (path_cast<dir_path> (move (p)), r);
+        break;
+      case entry_type::regular:
+        if (cxx_file (p))
+          r.push_back (move (p));
+        break;
+      default:
+        break;
+      }
+    }
+  }
+  catch (const system_error& e)
+  {
+    fail << "unable to iterate over " << d << ": " << e;
+  }
+}
+
+static void
+write_file (const path& f, const string& s)
+{
+  try
+  {
+    ofdstream os (f);
+    os << s;
+    os.close ();
+  }
+  catch (const io_error& e)
+  {
+    fail << "unable to write to " << f << ": " << e;
+  }
+}
+
+// Generate the synthetic corpus returning the paths of the generated files.
+//
+// Besides a typical small header, the corpus contains large headers that
+// are the worst case for the scanner since they don't contain any macros
+// outside comments and string literals and so have to be scanned in full:
+// a header consisting mostly of comment blocks, a header with raw string
+// literals, and a generated header with large data tables.
+//
+static paths
+generate (const dir_path& d, size_t size)
+{
+  try
+  {
+    if (butl::try_mkdir_p (d) == butl::mkdir_status::already_exists)
+      fail << "directory " << d << " already exists";
+  }
+  catch (const system_error& e)
+  {
+    fail << "unable to create directory " << d << ": " << e;
+  }
+
+  paths r;
+
+  // Typical header with the macro close to the beginning.
+  //
+  {
+    path f (d / "qobject.hxx");
+
+    write_file (f,
+                "#pragma once\n"
+                "\n"
+                "#include <QObject>\n"
+                "\n"
+                "class object: public QObject\n"
+                "{\n"
+                "  Q_OBJECT\n"
+                "\n"
+                "public:\n"
+                "  explicit\n"
+                "  object (QObject* p = nullptr): QObject (p) {}\n"
+                "\n"
+                "signals:\n"
+                "  void\n"
+                "  changed (int);\n"
+                "};\n");
+
+    r.push_back (move (f));
+  }
+
+  // Large comment blocks that mention the macros.
+  //
+  {
+    path f (d / "comments.hxx");
+    string s ("#pragma once\n\n");
+
+    while (s.size () < size)
+    {
+      s += "/*\n";
+      for (size_t i (0); i != 32; ++i)
+        s += " * Derive from QObject and add Q_OBJECT to use signals and "
+             "slots.\n";
+      s += " */\n";
+
+      for (size_t i (0); i != 32; ++i)
+        s += "// See also Q_GADGET and Q_NAMESPACE for the lightweight "
+             "alternatives.\n";
+
+      s += "int f" + to_string (s.size ()) + " ();\n\n";
+    }
+
+    write_file (f, s);
+    r.push_back (move (f));
+  }
+
+  // Raw string literals that mention the macros.
+  //
+  {
+    path f (d / "raw-strings.hxx");
+    string s ("#pragma once\n\n");
+
+    while (s.size () < size)
+    {
+      s += "const char* s" + to_string (s.size ()) + " = R\"delim(\n";
+      for (size_t i (0); i != 32; ++i)
+        s += "class c: public QObject { Q_OBJECT }; // \"quoted\" )\"\n";
+      s += ")delim\";\n\n";
+    }
+
+    write_file (f, s);
+    r.push_back (move (f));
+  }
+
+  // Generated header with large data tables.
+  //
+  {
+    path f (d / "generated.hxx");
+    string s ("#pragma once\n\nstatic const unsigned char data[] = {\n");
+
+    for (size_t i (0); s.size () < size; ++i)
+    {
+      s += "  0x";
+      s += "0123456789abcdef"[(i >> 4) & 0x0f];
+      s += "0123456789abcdef"[i & 0x0f];
+      s += (i % 16 == 15 ? ",\n" : ",");
+    }
+
+    s += "\n};\n";
+
+    write_file (f, s);
+    r.push_back (move (f));
+  }
+
+  return r;
+}
+
+int
+main (int argc, char* argv[])
+try
+{
+  size_t iterations (3);
+  size_t size (4);
+  size_t slowest (5);
+  optional<dir_path> gen;
+  paths files;
+
+  auto num = [] (const char* o, const char* v) -> size_t
+  {
+    size_t r (0);
+    try
+    {
+      r = static_cast<size_t> (stoull (v));
+    }
+    catch (const std::exception&)
+    {
+      fail << "invalid " << o << " value '" << v << "'";
+    }
+    return r;
+  };
+
+  for (int i (1); i != argc; ++i)
+  {
+    string a (argv[i]);
+
+    if (a == "--iterations" || a == "--size" || a == "--slowest" ||
+        a == "--generate")
+    {
+      if (++i == argc)
+        fail << "missing " << a << " value";
+
+      if (a == "--iterations")
+        iterations = num (a.c_str (), argv[i]);
+      else if (a == "--size")
+        size = num (a.c_str (), argv[i]);
+      else if (a == "--slowest")
+        slowest = num (a.c_str (), argv[i]);
+      else
+        gen = dir_path (argv[i]);
+    }
+    else if (a.size () > 1 && a[0] == '-')
+      fail << "unknown option " << a;
+    else
+    {
+      path p (move (a));
+
+      if (butl::dir_exists (p))
+        collect (path_cast<dir_path> (move (p)), files);
+      else
+        files.push_back (move (p));
+    }
+  }
+
+  if (gen)
+  {
+    for (path& f: generate (*gen, size * 1024 * 1024))
+      files.push_back (move (f));
+  }
+
+  if (files.empty ())
+    fail << "no files to scan" <<
+      info << "usage: automoc-scan [<options>] <path>...";
+
+  if (iterations == 0)
+    iterations = 1;
+
+  // Per-file results.
+  //
+  struct result
+  {
+    const path* file;
+    uint64_t    size;
+    nanoseconds time;   // Fastest run.
+    uint64_t    tokens;
+    bool        macro;
+  };
+
+  vector<result> rs;
+  rs.reserve (files.size ());
+
+  for (const path& f: files)
+  {
+    auto pe (butl::path_entry (f, true /* follow_symlinks */));
+
+    if (!pe.first)
+      fail << "file " << f << " does not exist";
+
+    rs.push_back (result {&f, pe.second.size, nanoseconds::max (), 0, false});
+  }
+
+  for (size_t i (0); i != iterations; ++i)
+  {
+    for (result& r: rs)
+    {
+      uint64_t tokens (0);
+
+      steady_clock::time_point s (steady_clock::now ());
+      bool m (qt::moc::scan_moc_macros (*r.file, &tokens));
+      nanoseconds d (steady_clock::now () - s);
+
+      if (d < r.time)
+        r.time = d;
+
+      r.tokens = tokens;
+      r.macro = m;
+    }
+  }
+
+  uint64_t bytes (0), tokens (0), macros (0);
+  nanoseconds time (0);
+
+  for (const result& r: rs)
+  {
+    bytes += r.size;
+    tokens += r.tokens;
+    time += r.time;
+
+    if (r.macro)
+      ++macros;
+  }
+
+  auto mbps = [] (uint64_t b, nanoseconds t)
+  {
+    return t.count () != 0
+      ? (static_cast<double> (b) / (1024 * 1024)) / (t.count () / 1e9)
+      : 0.0;
+  };
+
+  double s (time.count () / 1e9);
+
+  cout.setf (ios::fixed);
+  cout.precision (1);
+
+  cout << "files:      " << rs.size () << " (" << macros << " with macros)"
+       << '\n'
+       << "bytes:      " << bytes << '\n'
+       << "tokens:     " << tokens << '\n'
+       << "time:       " << s * 1000 << " ms (fastest of " << iterations
+       << " iterations)" << '\n'
+       << "throughput: " << mbps (bytes, time) << " MB/s, "
+       << (s != 0 ? rs.size () / s : 0.0) << " files/s" << '\n';
+
+  // Print the files with the lowest throughput. Note that only the files
+  // that were scanned in full (no macro found) are considered since the
+  // scan stops at the first macro.
+  //
+  if (slowest != 0)
+  {
+    sort (rs.begin (), rs.end (),
+          [&mbps] (const result& x, const result& y)
+          {
+            return mbps (x.size, x.time) < mbps (y.size, y.time);
+          });
+
+    cout << "slowest:" << '\n';
+
+    size_t n (0);
+    for (const result& r: rs)
+    {
+      if (r.macro || r.size == 0)
+        continue;
+
+      if (n++ == slowest)
+        break;
+
+      cout << "  " << mbps (r.size, r.time) << " MB/s  "
+           << r.size / 1024 << " KB  " << *r.file << '\n';
+    }
+  }
+
+  return 0;
+}
+catch (const failed&)
+{
+  return 1;
+}
@@ -0,0 +1,301 @@
+// Usage: qt-change-journal [<options>] <journal> <dir>...
+//
+// Watch the specified directories (recursively) for changes using inotify
+// and record the changed files in the journal file that can be queried by
+// the Qt compilers build system module instead of checking the modification
+// times of all the recorded dependencies (see config.qt.change_journal and
+// README.md for details). Linux only.
+//
+// --interval <ms>
+//    Heartbeat interval in milliseconds, 100 by default.
+//
+// The journal file has the following format:
+//
+// qt.change-journal 1
+// start <time>
+// interval <ms>
+// root <dir>
+// ...
+// <time> <path>
+// ...
+//
+// Where <time> is the number of nanoseconds since the UNIX epoch. The start
+// time is the time since which all the changes in the root directories are
+// recorded and each <time> <path> line records a change (modification,
+// creation, removal, or rename) of a file at or before the specified time.
+//
+// Every interval the watcher sets the journal file's modification time to a
+// time before which all the changes have been recorded ("heartbeat"). The
+// journal is considered stale if its modification time is not recent.
+//
+// If the inotify event queue overflows, then the journal is started afresh
+// (with a new start time).
+//
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>  // realpath()
+#include <cstring>  // strerror(), strcmp()
+#include <iostream>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <limits.h>    // PATH_MAX
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+using namespace std;
+
+using std::chrono::system_clock;
+using std::chrono::nanoseconds;
+
+[[noreturn]] static void
+fail (const string& m)
+{
+  cerr << "error: " << m << endl;
+  exit (1);
+}
+
+static long long
+now ()
+{
+  return chrono::duration_cast<nanoseconds> (
+    system_clock::now ().time_since_epoch ()).count ();
+}
+
+static int ifd;                       // inotify descriptor.
+static map<int, string> watches;      // Watch descriptor to directory.
+static vector<string> roots;
+
+static const uint32_t mask (IN_MODIFY      | IN_ATTRIB     | IN_CLOSE_WRITE |
+                            IN_CREATE      | IN_DELETE     | IN_MOVED_FROM  |
+                            IN_MOVED_TO    | IN_DELETE_SELF | IN_MOVE_SELF  |
+                            IN_ONLYDIR     | IN_DONT_FOLLOW);
+
+// Add watches for the directory and all its subdirectories.
+//
+static void
+watch (const string& d)
+{
+  int wd (inotify_add_watch (ifd, d.c_str (), mask));
+
+  if (wd == -1)
+  {
+    // The directory could have been removed while we were iterating.
+    //
+    if (errno == ENOENT || errno == ENOTDIR)
+      return;
+
+    fail ("unable to watch " + d + ": " + strerror (errno));
+  }
+
+  watches[wd] = d;
+
+  if (DIR* dp = opendir (d.c_str ()))
+  {
+    while (dirent* de = readdir (dp))
+    {
+      if (strcmp (de->d_name, ".") == 0 || strcmp (de->d_name, "..") == 0)
+        continue;
+
+      string p (d + '/' + de->d_name);
+
+      struct stat s;
+      if (lstat (p.c_str (), &s) == 0 && S_ISDIR (s.st_mode))
+        watch (p);
+    }
+
+    closedir (dp);
+  }
+}
+
+// (Re)start the journal: (re)establish the watches and write the header.
+//
+static int
+start (const string& journal, long interval)
+{
+  for (const auto& w: watches)
+    inotify_rm_watch (ifd, w.first);
+
+  watches.clear ();
+
+  for (const string& r: roots)
+    watch (r);
+
+  // Only now, once all the watches are established, can we guarantee that
+  // all the changes are recorded.
+  //
+  string h ("qt.change-journal 1\n");
+  h += "start " + to_string (now ()) + '\n';
+  h += "interval " + to_string (interval) + '\n';
+
+  for (const string& r: roots)
+    h += "root " + r + '\n';
+
+  // Write the header to a temporary file and rename it over the journal so
+  // that the readers never see a partial header.
+  //
+  string t (journal + ".tmp");
+
+  int fd (open (t.c_str (), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666));
+
+  if (fd == -1 ||
+      write (fd, h.c_str (), h.size ()) != static_cast<ssize_t> (h.size ()) ||
+      rename (t.c_str (), journal.c_str ()) == -1)
+    fail ("unable to write to " + journal + ": " + strerror (errno));
+
+  return fd;
+}
+
+int
+main (int argc, char* argv[])
+{
+  long interval (100);
+  string journal;
+
+  for (int i (1); i != argc; ++i)
+  {
+    string a (argv[i]);
+
+    if (a == "--interval")
+    {
+      if (++i == argc)
+        fail ("missing --interval value");
+
+      interval = atol (argv[i]);
+
+      if (interval <= 0)
+        fail ("invalid --interval value '" + string (argv[i]) + "'");
+    }
+    else if (a.size () > 1 && a[0] == '-')
+      fail ("unknown option " + a);
+    else if (journal.empty ())
+      journal = move (a);
+    else
+    {
+      // Note that the module compares the paths textually so we use the
+      // real paths (no symlinks, absolute, and normalized).
+      //
+      char r[PATH_MAX];
+      if (realpath (a.c_str (), r) == nullptr)
+        fail ("invalid directory " + a + ": " + strerror (errno));
+
+      roots.push_back (r);
+    }
+  }
+
+  if (roots.empty ())
+    fail ("usage: qt-change-journal [<options>] <journal> <dir>...");
+
+  if ((ifd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC)) == -1)
+    fail (string ("unable to initialize inotify: ") + strerror (errno));
+
+  int fd (start (journal, interval));
+
+  // Ignore the changes to the journal itself in case it is inside one of the
+  // watched directories.
+  //
+  string self;
+  {
+    char r[PATH_MAX];
+    if (realpath (journal.c_str (), r) != nullptr)
+      self = r;
+  }
+
+  alignas (inotify_event) char buf[64 * 1024];
+
+  for (;;)
+  {
+    // All the changes made before this time are in the event queue by the
+    // time we are done reading it.
+    //
+    long long t (now ());
+
+    pollfd p {ifd, POLLIN, 0};
+    if (poll (&p, 1, static_cast<int> (interval)) == -1 && errno != EINTR)
+      fail (string ("unable to poll: ") + strerror (errno));
+
+    string r;
+    set<string> fs; // Files changed in this batch.
+    bool overflow (false);
+
+    for (;;)
+    {
+      ssize_t n (read (ifd, buf, sizeof (buf)));
+
+      if (n == -1)
+      {
+        if (errno == EAGAIN || errno == EINTR)
+          break;
+
+        fail (string ("unable to read inotify events: ") + strerror (errno));
+      }
+
+      // Note that the time of reading is at or after the time of the change.
+      //
+      string ts (to_string (now ()));
+
+      for (char* i (buf); i < buf + n; )
+      {
+        const inotify_event& e (*reinterpret_cast<inotify_event*> (i));
+        i += sizeof (inotify_event) + e.len;
+
+        if ((e.mask & IN_Q_OVERFLOW) != 0)
+        {
+          overflow = true;
+          continue;
+        }
+
+        auto w (watches.find (e.wd));
+        if (w == watches.end ())
+          continue;
+
+        string f (e.len != 0 ? w->second + '/' + e.name : w->second);
+
+        if (f == self || f == self + ".tmp")
+          continue;
+
+        if (fs.insert (f).second)
+          r += ts + ' ' + f + '\n';
+
+        // Watch the new directories. Note that the files created in such a
+        // directory before we have started watching it are recorded since
+        // the directory itself is recorded as changed and so any path in it
+        // is considered changed (see the module for details).
+        //
+        if ((e.mask & IN_ISDIR) != 0 &&
+            (e.mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+          watch (f);
+
+        if ((e.mask & IN_IGNORED) != 0)
+          watches.erase (w);
+      }
+    }
+
+    if (overflow)
+    {
+      close (fd);
+      fd = start (journal, interval);
+      continue;
+    }
+
+    if (!r.empty () &&
+        write (fd, r.c_str (), r.size ()) != static_cast<ssize_t> (r.size ()))
+      fail ("unable to write to " + journal + ": " + strerror (errno));
+
+    // Heartbeat.
+    //
+    timespec ts[2];
+    ts[0].tv_sec = ts[1].tv_sec = static_cast<time_t> (t / 1000000000);
+    ts[0].tv_nsec = ts[1].tv_nsec = static_cast<long> (t % 1000000000);
+
+    if (futimens (fd, ts) == -1)
+      fail ("unable to update " + journal + ": " + strerror (errno));
+  }
+}
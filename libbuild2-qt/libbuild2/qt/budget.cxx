@@ -0,0 +1,75 @@
+#include <libbuild2/qt/budget.hxx>
+
+#include <libbuild2/scheduler.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    uint64_t budget::
+    acquire (context& ctx, uint64_t n, bool* waited)
+    {
+      if (n > capacity_)
+        n = capacity_;
+
+      mlock l (mutex_);
+
+      if (used_ + n <= capacity_)
+      {
+        used_ += n;
+
+        if (waited != nullptr)
+          *waited = false;
+
+        return n;
+      }
+
+      if (waited != nullptr)
+        *waited = true;
+
+      // Deactivate the thread for the duration of the wait so that the
+      // scheduler can run other tasks in its place.
+      //
+      // Note that activate() may block until there is an active thread slot
+      // available so we must not hold the lock while calling it.
+      //
+      l.unlock ();
+      ctx.sched->deactivate (false /* external */);
+      l.lock ();
+
+      cv_.wait (l, [this, n] {return used_ + n <= capacity_;});
+      used_ += n;
+
+      l.unlock ();
+      ctx.sched->activate (false /* external */);
+
+      return n;
+    }
+
+    void budget::
+    release (uint64_t n)
+    {
+      {
+        mlock l (mutex_);
+        used_ -= n;
+      }
+
+      cv_.notify_all ();
+    }
+
+    budget::guard::
+    guard (budget* b, context& ctx, uint64_t n)
+        : budget_ (b)
+    {
+      if (budget_ != nullptr)
+        amount_ = budget_->acquire (ctx, n, &waited_);
+    }
+
+    budget::guard::
+    ~guard ()
+    {
+      if (budget_ != nullptr)
+        budget_->release (amount_);
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/context.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Budget of a resource (memory, processes, etc) shared by the concurrent
+    // recipes of a rule which is used to throttle their execution without
+    // lowering the overall build concurrency.
+    //
+    // A recipe acquires its estimated amount of the resource before starting
+    // the expensive part of its work (normally running a compiler) and
+    // releases it afterwards. If the amount is not available, the calling
+    // thread waits until it is, deactivating itself with the scheduler for
+    // the duration of the wait so that other (unthrottled) work can proceed
+    // in its place. An amount that exceeds the capacity is reduced to the
+    // capacity (that is, such a recipe is executed exclusively).
+    //
+    class LIBBUILD2_QT_SYMEXPORT budget
+    {
+    public:
+      explicit
+      budget (uint64_t capacity): capacity_ (capacity) {}
+
+      budget (const budget&) = delete;
+      budget& operator= (const budget&) = delete;
+
+      uint64_t
+      capacity () const {return capacity_;}
+
+      // Acquire the specified amount, blocking if necessary, and return the
+      // amount actually acquired (which should be passed to release()). If
+      // waited is not NULL, then set it to true if the calling thread had to
+      // wait and to false otherwise.
+      //
+      uint64_t
+      acquire (context&, uint64_t, bool* waited = nullptr);
+
+      void
+      release (uint64_t);
+
+      // Acquire the amount in the constructor and release it in the
+      // destructor. All the operations are no-ops if the budget is NULL.
+      //
+      class guard
+      {
+      public:
+        guard (budget*, context&, uint64_t);
+        ~guard ();
+
+        guard (const guard&) = delete;
+        guard& operator= (const guard&) = delete;
+
+        // Return true if the calling thread had to wait.
+        //
+        bool
+        waited () const {return waited_;}
+
+      private:
+        budget* budget_;
+        uint64_t amount_ = 0;
+        bool waited_ = false;
+      };
+
+    private:
+      const uint64_t capacity_;
+      uint64_t used_ = 0;
+
+      mutex mutex_;
+      std::condition_variable cv_;
+    };
+  }
+}
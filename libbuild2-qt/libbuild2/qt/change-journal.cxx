@@ -0,0 +1,269 @@
+#include <libbuild2/qt/change-journal.hxx>
+
+#include <thread> // this_thread::sleep_for()
+
+#include <libbuild2/scope.hxx>
+#include <libbuild2/scheduler.hxx>
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Journals opened by this process (see open()).
+    //
+    static mutex journals_mutex;
+    static map<path, std::weak_ptr<change_journal>> journals;
+
+    shared_ptr<change_journal> change_journal::
+    open (const path& p)
+    {
+      mlock l (journals_mutex);
+
+      std::weak_ptr<change_journal>& w (journals[p]);
+
+      shared_ptr<change_journal> r (w.lock ());
+      if (r == nullptr)
+      {
+        r = make_shared<change_journal> (p);
+        w = r;
+      }
+
+      return r;
+    }
+
+    change_journal::
+    change_journal (path p)
+        : path_ (move (p))
+    {
+    }
+
+    // Parse the time in nanoseconds since epoch.
+    //
+    static optional<timestamp>
+    parse_time (const string& s, size_t b, size_t e)
+    {
+      try
+      {
+        std::chrono::nanoseconds ns (stoull (string (s, b, e - b)));
+        return timestamp (std::chrono::duration_cast<duration> (ns));
+      }
+      catch (const std::exception&) // invalid_argument, out_of_range
+      {
+        return nullopt;
+      }
+    }
+
+    bool change_journal::
+    read (state& s) const
+    {
+      ifdstream is (path_);
+      bool r (parse (is, s));
+      is.close ();
+      return r;
+    }
+
+    bool change_journal::
+    parse (istream& is, state& s)
+    {
+      s.roots.clear ();
+      s.changes.clear ();
+
+      string l;
+      if (eof (getline (is, l)) || l != "qt.change-journal 1")
+        return false;
+
+      optional<timestamp> start;
+      bool interval (false);
+
+      while (!eof (getline (is, l)))
+      {
+        size_t p (l.find (' '));
+
+        if (p == string::npos || p + 1 == l.size ())
+          continue; // Partially written line.
+
+        if (l.compare (0, p, "start") == 0)
+          start = parse_time (l, p + 1, l.size ());
+        else if (l.compare (0, p, "interval") == 0)
+        {
+          try
+          {
+            s.interval = std::chrono::milliseconds (
+              stoull (string (l, p + 1)));
+            interval = true;
+          }
+          catch (const std::exception&)
+          {
+            return false;
+          }
+        }
+        else if (l.compare (0, p, "root") == 0)
+          s.roots.push_back (dir_path (string (l, p + 1)));
+        else if (optional<timestamp> t = parse_time (l, 0, p))
+        {
+          timestamp& c (s.changes[string (l, p + 1)]);
+
+          if (*t > c)
+            c = *t;
+        }
+      }
+
+      if (!start || !interval || s.roots.empty ())
+        return false;
+
+      s.start = *start;
+      return true;
+    }
+
+    void change_journal::
+    load (context& ctx, state& s) const
+    {
+      tracer trace ("qt::change_journal::load");
+
+      timestamp now (system_clock::now ());
+
+      // Wait for a heartbeat certifying that all the changes made before now
+      // are recorded, giving up after a few intervals.
+      //
+      for (size_t i (0);; ++i)
+      {
+        // Note that the heartbeat must be checked before reading the journal
+        // (the changes recorded after the heartbeat are just extra).
+        //
+        timestamp h (file_mtime (path_));
+
+        if (h == timestamp_nonexistent)
+        {
+          if (verb >= 2)
+            info << "change journal " << path_ << " does not exist, "
+                 << "falling back to modification time checks";
+          return;
+        }
+
+        try
+        {
+          if (!read (s))
+          {
+            if (verb >= 2)
+              info << "invalid change journal " << path_ << ", falling "
+                   << "back to modification time checks";
+            return;
+          }
+        }
+        catch (const io_error& e)
+        {
+          if (verb >= 2)
+            info << "unable to read change journal " << path_ << ": " << e <<
+              info << "falling back to modification time checks";
+          return;
+        }
+
+        if (h >= now)
+          break;
+
+        if (i == 3)
+        {
+          if (verb >= 2)
+            info << "change journal " << path_ << " is stale (is "
+                 << "qt-change-journal running?), falling back to "
+                 << "modification time checks";
+          return;
+        }
+
+        l5 ([&]{trace << "waiting for " << path_ << " heartbeat";});
+
+        // Deactivate the thread in the scheduler while waiting so that
+        // other threads can continue matching.
+        //
+        ctx.sched->deactivate (false /* external */);
+        std::this_thread::sleep_for (s.interval);
+        ctx.sched->activate (false /* external */);
+      }
+
+      l5 ([&]{trace << "loaded " << s.changes.size () << " changes from "
+                    << path_;});
+
+      s.valid = true;
+    }
+
+    optional<bool> change_journal::
+    changed (context& ctx, const path& f, timestamp t)
+    {
+      // Load the journal on the first query of the operation since the
+      // files may have changed between operations (for example, in a
+      // long-running build system process). While it is being loaded (which
+      // may involve waiting for the watcher), the other threads fall back to
+      // checking the modification time rather than waiting.
+      //
+      shared_ptr<const state> s;
+      {
+        mlock l (mutex_);
+
+        if (ctx_ != &ctx || on_ != ctx.current_on)
+        {
+          if (loading_)
+            return nullopt;
+
+          loading_ = true;
+          l.unlock ();
+
+          shared_ptr<state> n (make_shared<state> ());
+
+          try
+          {
+            load (ctx, *n);
+          }
+          catch (...)
+          {
+            l.lock ();
+            loading_ = false;
+            throw;
+          }
+
+          l.lock ();
+          loading_ = false;
+
+          state_ = move (n);
+          ctx_ = &ctx;
+          on_ = ctx.current_on;
+        }
+
+        s = state_;
+      }
+
+      if (!s->valid || t < s->start || t == timestamp_unknown)
+        return nullopt;
+
+      // The file must be in one of the watched directories.
+      //
+      auto r (find_if (s->roots.begin (), s->roots.end (),
+                       [&f] (const dir_path& d) {return f.sub (d);}));
+
+      if (r == s->roots.end ())
+        return nullopt;
+
+      // But not in an output directory (see above).
+      //
+      if (const scope* rs = ctx.scopes.find_out (f.directory ()).root_scope ())
+      {
+        if (f.sub (rs->out_path ()))
+          return nullopt;
+      }
+
+      // Note that if a directory was changed (for example, created or
+      // renamed), then everything in it is considered changed.
+      //
+      for (path p (f); p.sub (*r) && p != *r; p = p.directory ())
+      {
+        auto i (s->changes.find (p.string ()));
+
+        if (i != s->changes.end () && i->second >= t)
+          return true;
+      }
+
+      return false;
+    }
+  }
+}
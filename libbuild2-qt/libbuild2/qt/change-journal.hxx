@@ -0,0 +1,93 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/context.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Change journal maintained by the qt-change-journal watcher (see
+    // journal/watcher.cxx for the file format and config.qt.change_journal
+    // for details).
+    //
+    // The journal records the files changed in the watched (source)
+    // directories and allows the rules to determine whether a recorded
+    // dependency has changed since the output was produced without checking
+    // its modification time (which would also require entering and matching
+    // its target).
+    //
+    // The journal is read on the first query of each operation, and only if
+    // it is fresh (that is, the watcher has certified that all the changes
+    // made before the query are recorded; see the heartbeat in the
+    // watcher). If the journal is missing, stale, being read by another
+    // thread, or does not cover the file in question, then the query
+    // returns nullopt and the rule should fall back to checking the
+    // modification time.
+    //
+    class LIBBUILD2_QT_SYMEXPORT change_journal
+    {
+    public:
+      // Return the journal for the specified file, creating it if necessary.
+      // The journal is shared by all the projects that use the same file.
+      //
+      static shared_ptr<change_journal>
+      open (const path&);
+
+      explicit
+      change_journal (path);
+
+      // Return true if the file has (or may have) changed after the
+      // specified time, false if it has not, and nullopt if the journal
+      // cannot tell.
+      //
+      // Note that the files in the output directories of the projects
+      // loaded in this context are never covered since they may be
+      // generated and their targets need to be matched and updated.
+      //
+      optional<bool>
+      changed (context&, const path&, timestamp);
+
+      // The journal state as of the last load.
+      //
+      struct state
+      {
+        bool                   valid = false;
+        timestamp              start;
+        duration               interval;
+        dir_paths              roots;
+        map<string, timestamp> changes; // Latest change time.
+      };
+
+      // Parse the journal from the stream returning false if it is invalid
+      // (the partially written lines are skipped). Note that the valid flag
+      // is not set (see load()).
+      //
+      static bool
+      parse (istream&, state&);
+
+    private:
+      void
+      load (context&, state&) const;
+
+      bool
+      read (state&) const;
+
+      const path path_;
+
+      // The state is loaded for the current operation (see changed()) and
+      // is immutable once loaded so that it can be queried without holding
+      // the mutex.
+      //
+      mutex                   mutex_;
+      const context*          ctx_ = nullptr; // Context and operation number
+      size_t                  on_ = 0;        // the state was loaded for.
+      bool                    loading_ = false;
+      shared_ptr<const state> state_;
+    };
+  }
+}
@@ -0,0 +1,140 @@
+#include <sstream>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/qt/change-journal.hxx>
+
+#undef NDEBUG
+#include <cassert>
+
+namespace build2
+{
+  namespace qt
+  {
+    using state = change_journal::state;
+
+    static bool
+    parse (const string& s, state& r)
+    {
+      std::istringstream is (s);
+      return change_journal::parse (is, r);
+    }
+
+    static timestamp
+    ns (uint64_t n)
+    {
+      return timestamp (
+        std::chrono::duration_cast<duration> (std::chrono::nanoseconds (n)));
+    }
+
+    int
+    main ()
+    {
+      // Valid.
+      //
+      {
+        state s;
+        assert (parse ("qt.change-journal 1\n"
+                       "start 100\n"
+                       "interval 250\n"
+                       "root /tmp/a/\n"
+                       "root /tmp/b/\n"
+                       "200 /tmp/a/x.hxx\n"
+                       "300 /tmp/b/y.hxx\n"
+                       "150 /tmp/a/x.hxx\n",
+                       s));
+
+        assert (s.start == ns (100));
+        assert (s.interval == std::chrono::milliseconds (250));
+        assert (s.roots.size () == 2 &&
+                s.roots[0] == dir_path ("/tmp/a") &&
+                s.roots[1] == dir_path ("/tmp/b"));
+
+        // The latest change time is kept.
+        //
+        assert (s.changes.size () == 2);
+        assert (s.changes["/tmp/a/x.hxx"] == ns (200));
+        assert (s.changes["/tmp/b/y.hxx"] == ns (300));
+        assert (!s.valid);
+      }
+
+      // Partially written lines.
+      //
+      {
+        state s;
+        assert (parse ("qt.change-journal 1\n"
+                       "start 100\n"
+                       "interval 250\n"
+                       "root /tmp/a/\n"
+                       "200 /tmp/a/x.hxx\n"
+                       "300 \n"
+                       "400",
+                       s));
+
+        assert (s.changes.size () == 1);
+      }
+
+      // The result of the previous parse is discarded.
+      //
+      {
+        state s;
+        assert (parse ("qt.change-journal 1\n"
+                       "start 100\n"
+                       "interval 250\n"
+                       "root /tmp/a/\n"
+                       "200 /tmp/a/x.hxx\n",
+                       s));
+
+        assert (parse ("qt.change-journal 1\n"
+                       "start 100\n"
+                       "interval 250\n"
+                       "root /tmp/b/\n",
+                       s));
+
+        assert (s.roots.size () == 1 && s.changes.empty ());
+      }
+
+      // Invalid.
+      //
+      {
+        state s;
+        assert (!parse ("", s));
+        assert (!parse ("qt.change-journal 2\n"
+                        "start 100\n"
+                        "interval 250\n"
+                        "root /tmp/a/\n",
+                        s));
+
+        assert (!parse ("qt.change-journal 1\n" // No start.
+                        "interval 250\n"
+                        "root /tmp/a/\n",
+                        s));
+
+        assert (!parse ("qt.change-journal 1\n" // No interval.
+                        "start 100\n"
+                        "root /tmp/a/\n",
+                        s));
+
+        assert (!parse ("qt.change-journal 1\n" // No roots.
+                        "start 100\n"
+                        "interval 250\n",
+                        s));
+
+        assert (!parse ("qt.change-journal 1\n" // Invalid interval.
+                        "start 100\n"
+                        "interval x\n"
+                        "root /tmp/a/\n",
+                        s));
+      }
+
+      return 0;
+    }
+  }
+}
+
+int
+main ()
+{
+  return build2::qt::main ();
+}
@@ -0,0 +1,43 @@
+#include <libbuild2/qt/counters.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    bool rule_counters::
+    empty () const
+    {
+      return stats.load (memory_order_relaxed)        == 0 &&
+             depdb_reads.load (memory_order_relaxed)  == 0 &&
+             depdb_writes.load (memory_order_relaxed) == 0 &&
+             lookups.load (memory_order_relaxed)      == 0 &&
+             tokens.load (memory_order_relaxed)       == 0 &&
+             processes.load (memory_order_relaxed)    == 0 &&
+             bytes.load (memory_order_relaxed)        == 0 &&
+             journal.load (memory_order_relaxed)      == 0 &&
+             prefilter.load (memory_order_relaxed)    == 0 &&
+             fingerprint.load (memory_order_relaxed)  == 0;
+    }
+
+    void rule_counters::
+    print (diag_record& dr, const char* rule)
+    {
+      auto take = [] (atomic<uint64_t>& c)
+      {
+        return c.exchange (0, memory_order_relaxed);
+      };
+
+      dr << info << rule << ':'
+         << " stat "       << take (stats)
+         << ", depdb read " << take (depdb_reads)
+         << ", depdb write " << take (depdb_writes)
+         << ", lookup "    << take (lookups)
+         << ", token "     << take (tokens)
+         << ", process "   << take (processes)
+         << ", byte "      << take (bytes)
+         << ", journal "   << take (journal)
+         << ", prefilter " << take (prefilter)
+         << ", fingerprint " << take (fingerprint);
+    }
+  }
+}
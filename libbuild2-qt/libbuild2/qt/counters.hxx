@@ -0,0 +1,60 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/depdb.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Hot-path counters of a rule, primarily of the filesystem and process
+    // activity that contributes to the no-op build latency.
+    //
+    // The counters are updated with relaxed atomic operations and so are
+    // cheap enough to be always enabled. They are printed at the end of
+    // update and clean if requested (see config.qt.stats).
+    //
+    struct LIBBUILD2_QT_SYMEXPORT rule_counters
+    {
+      atomic<uint64_t> stats        {0}; // File stat calls (mtime, size).
+      atomic<uint64_t> depdb_reads  {0}; // Depdb lines read.
+      atomic<uint64_t> depdb_writes {0}; // Depdb lines written.
+      atomic<uint64_t> lookups      {0}; // Dynamic dependency target lookups.
+      atomic<uint64_t> tokens       {0}; // Lexer tokens scanned.
+      atomic<uint64_t> processes    {0}; // Processes spawned.
+      atomic<uint64_t> bytes        {0}; // Bytes generated.
+      atomic<uint64_t> journal      {0}; // Lookups avoided via change journal.
+      atomic<uint64_t> prefilter    {0}; // Processes avoided via prefilter.
+      atomic<uint64_t> fingerprint  {0}; // Updates avoided via fingerprint.
+
+      static void
+      increment (atomic<uint64_t>& c, uint64_t n = 1)
+      {
+        c.fetch_add (n, memory_order_relaxed);
+      }
+
+      // Account for a depdb line read or written based on the state of the
+      // database after the operation.
+      //
+      void
+      depdb_line (const depdb& dd)
+      {
+        increment (dd.writing () ? depdb_writes : depdb_reads);
+      }
+
+      bool
+      empty () const;
+
+      // Print the counters as an info line of the specified diagnostics
+      // record and reset them.
+      //
+      void
+      print (diag_record&, const char* rule);
+    };
+  }
+}
@@ -0,0 +1,203 @@
+#include <libbuild2/qt/event-trace.hxx>
+
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Append a JSON string literal.
+    //
+    static void
+    json_string (string& r, const string& s)
+    {
+      r += '"';
+      for (char c: s)
+      {
+        switch (c)
+        {
+        case '"':  r += "\\\""; break;
+        case '\\': r += "\\\\"; break;
+        case '\n': r += "\\n";  break;
+        case '\r': r += "\\r";  break;
+        case '\t': r += "\\t";  break;
+        default:
+          {
+            if (static_cast<unsigned char> (c) < 0x20)
+            {
+              const char* x ("0123456789abcdef");
+              r += "\\u00";
+              r += x[(c >> 4) & 0x0f];
+              r += x[c & 0x0f];
+            }
+            else
+              r += c;
+          }
+        }
+      }
+      r += '"';
+    }
+
+    // Traces opened by this process (see open()).
+    //
+    static mutex traces_mutex;
+    static map<path, std::weak_ptr<event_trace>> traces;
+
+    shared_ptr<event_trace> event_trace::
+    open (const path& p)
+    {
+      mlock l (traces_mutex);
+
+      std::weak_ptr<event_trace>& w (traces[p]);
+
+      shared_ptr<event_trace> r (w.lock ());
+      if (r == nullptr)
+      {
+        r = make_shared<event_trace> (p);
+        w = r;
+      }
+
+      return r;
+    }
+
+    event_trace::
+    event_trace (path p)
+        : path_ (move (p)),
+          start_ (system_clock::now ()),
+          pid_ (static_cast<uint64_t> (process::current_id ()))
+    {
+      try
+      {
+        ofs_.open (path_);
+        ofs_ << '[';
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to write to " << path_ << ": " << e;
+      }
+    }
+
+    event_trace::
+    ~event_trace ()
+    {
+      try
+      {
+        ofs_ << "\n]\n";
+        ofs_.close ();
+      }
+      catch (const io_error&)
+      {
+        // Not much we can do here and the trace is usable without the
+        // closing bracket.
+      }
+    }
+
+    event_trace::arguments& event_trace::arguments::
+    operator() (const char* n, const string& v)
+    {
+      if (!json.empty ())
+        json += ',';
+
+      json_string (json, n);
+      json += ':';
+      json_string (json, v);
+      return *this;
+    }
+
+    event_trace::arguments& event_trace::arguments::
+    operator() (const char* n, uint64_t v)
+    {
+      if (!json.empty ())
+        json += ',';
+
+      json_string (json, n);
+      json += ':';
+      json += to_string (v);
+      return *this;
+    }
+
+    void event_trace::
+    complete (const char* cat,
+              const string& name,
+              timestamp start,
+              timestamp end,
+              const arguments& args)
+    {
+      using std::chrono::microseconds;
+      using std::chrono::duration_cast;
+
+      // Number the threads in the order they write their first event which
+      // is more readable than the platform thread ids.
+      //
+      static atomic<uint64_t> thread_count (0);
+      thread_local uint64_t tid (++thread_count);
+
+      uint64_t ts (start > start_
+                   ? duration_cast<microseconds> (start - start_).count ()
+                   : 0);
+      uint64_t dur (end > start
+                    ? duration_cast<microseconds> (end - start).count ()
+                    : 0);
+
+      // Serialize the event outside of the lock.
+      //
+      string ev ("{\"ph\":\"X\",\"cat\":");
+      json_string (ev, cat);
+      ev += ",\"name\":";
+      json_string (ev, name);
+      ev += ",\"pid\":";  ev += to_string (pid_);
+      ev += ",\"tid\":";  ev += to_string (tid);
+      ev += ",\"ts\":";   ev += to_string (ts);
+      ev += ",\"dur\":";  ev += to_string (dur);
+
+      if (!args.json.empty ())
+      {
+        ev += ",\"args\":{";
+        ev += args.json;
+        ev += '}';
+      }
+
+      ev += '}';
+
+      mlock l (mutex_);
+
+      try
+      {
+        ofs_ << (first_ ? "\n" : ",\n") << ev;
+        first_ = false;
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to write to " << path_ << ": " << e;
+      }
+    }
+
+    event_trace::span::
+    span (event_trace* t)
+        : trace_ (t)
+    {
+      if (trace_ != nullptr)
+        start_ = system_clock::now ();
+    }
+
+    void event_trace::span::
+    complete (const char* cat, const string& name, arguments&& args)
+    {
+      if (trace_ == nullptr)
+        return;
+
+      trace_->complete (cat, name, start_, system_clock::now (), args);
+    }
+
+    uint64_t event_trace::
+    file_size (const path& p)
+    {
+      auto pe (butl::path_entry (p,
+                                 true /* follow_symlinks */,
+                                 true /* ignore_error */));
+
+      return pe.first ? pe.second.size : 0;
+    }
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Trace of the Qt compiler invocations and other notable phases (automoc
+    // scan, depfile parsing, etc) in the Chrome trace event format which can
+    // be loaded into chrome://tracing or Perfetto.
+    //
+    // The trace is enabled with the config.qt.trace variable and is shared
+    // by all the qt modules of all the projects that specify the same file.
+    // The events are written as they complete using the JSON array format.
+    // Since the closing `]` is optional in this format, the file is usable
+    // even if the build is interrupted.
+    //
+    class LIBBUILD2_QT_SYMEXPORT event_trace
+    {
+    public:
+      // Return the trace for the specified file opening (and truncating) it
+      // if it is not already open in this process.
+      //
+      static shared_ptr<event_trace>
+      open (const path&);
+
+      explicit
+      event_trace (path);
+
+      ~event_trace ();
+
+      event_trace (const event_trace&) = delete;
+      event_trace& operator= (const event_trace&) = delete;
+
+      // Event arguments (the `args` object).
+      //
+      class arguments
+      {
+      public:
+        arguments&
+        operator() (const char* name, const string& value);
+
+        arguments&
+        operator() (const char* name, uint64_t value);
+
+        string json; // Comma-separated "name":value pairs.
+      };
+
+      // Write a complete (`X`) event.
+      //
+      void
+      complete (const char* cat,
+                const string& name,
+                timestamp start,
+                timestamp end,
+                const arguments& = arguments ());
+
+      // Measure the duration of an event from construction until complete()
+      // is called. All the operations are no-ops if the trace is NULL.
+      //
+      // Note that we don't record the resource usage of the compiler
+      // processes since the only portable way to obtain it (getrusage() with
+      // RUSAGE_CHILDREN) is process-wide and so is not attributable to an
+      // individual invocation if several child processes run concurrently.
+      //
+      class span
+      {
+      public:
+        explicit
+        span (event_trace*);
+
+        explicit operator bool () const {return trace_ != nullptr;}
+
+        void
+        complete (const char* cat, const string& name, arguments&& = {});
+
+      private:
+        event_trace* trace_;
+        timestamp start_;
+      };
+
+      // Return the size of the file or 0 if it does not exist.
+      //
+      static uint64_t
+      file_size (const path&);
+
+    private:
+      path path_;
+      ofdstream ofs_;
+      timestamp start_;
+      uint64_t pid_;
+      bool first_ = true;
+      mutex mutex_;
+    };
+  }
+}
@@ -0,0 +1,455 @@
+#include <libbuild2/qt/fingerprint.hxx>
+
+#include <cstring> // strchr()
+
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Return true if the character can be part of an identifier, number, or
+    // literal prefix/suffix. Note that we treat the quotes as such to keep
+    // the separation between a literal and its prefix/suffix (think u8"x"
+    // and "x"_s).
+    //
+    static inline bool
+    word_char (char c)
+    {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+             (c >= '0' && c <= '9') || c == '_' || c == '"' || c == '\'' ||
+             (static_cast<unsigned char> (c) & 0x80) != 0;
+    }
+
+    // Return true if the two adjacent characters could be part of a single
+    // token (or, for punctuators, form a different one; think `- -` and
+    // `--`) if there were no whitespace between them.
+    //
+    static inline bool
+    merge_chars (char p, char c)
+    {
+      auto punct = [] (char c)
+      {
+        return strchr ("+-*/%^&|<>=!:.#", c) != nullptr;
+      };
+
+      auto digit = [] (char c) {return c >= '0' && c <= '9';};
+
+      bool pw (word_char (p)), cw (word_char (c));
+
+      return (pw && cw)                 ||
+             (punct (p) && punct (c))   ||
+             (digit (p) && c == '.')    ||
+             (p == '.' && digit (c));
+    }
+
+    static inline bool
+    space_char (char c)
+    {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    // Normalize C++ source: drop comments and collapse whitespace.
+    //
+    static string
+    normalize_cxx (const string& s)
+    {
+      string r;
+      r.reserve (s.size ());
+
+      size_t n (s.size ());
+      bool ws (false);  // Pending whitespace.
+      bool bol (true);  // Only whitespace/comments so far on this line.
+      bool dir (false); // In a preprocessor directive.
+
+      // Append the next token character, separating it from the previous
+      // one if there was whitespace in between and removing it could merge
+      // the two tokens (or, in directives, could change the meaning; think
+      // function-like vs object-like macros).
+      //
+      auto emit = [&r, &ws, &dir] (char c)
+      {
+        if (ws)
+        {
+          if (!r.empty () && r.back () != '\n')
+          {
+            char p (r.back ());
+
+            if (dir || merge_chars (p, c))
+              r += ' ';
+          }
+
+          ws = false;
+        }
+
+        r += c;
+      };
+
+      // Return true if the position is at a line splice (backslash-newline)
+      // and skip it.
+      //
+      auto splice = [&s, n] (size_t& i) -> bool
+      {
+        if (s[i] != '\\')
+          return false;
+
+        size_t j (i + 1);
+        if (j != n && s[j] == '\r')
+          ++j;
+
+        if (j != n && s[j] == '\n')
+        {
+          i = j + 1;
+          return true;
+        }
+
+        return false;
+      };
+
+      for (size_t i (0); i != n; )
+      {
+        if (splice (i))
+          continue;
+
+        char c (s[i]);
+
+        if (c == '\n')
+        {
+          if (dir)
+          {
+            r += '\n';
+            dir = false;
+          }
+          ws = !r.empty () && r.back () != '\n';
+          bol = true;
+          ++i;
+          continue;
+        }
+
+        if (space_char (c))
+        {
+          ws = true;
+          ++i;
+          continue;
+        }
+
+        // Comments (replaced with whitespace).
+        //
+        if (c == '/' && i + 1 != n && s[i + 1] == '/')
+        {
+          for (i += 2; i != n && s[i] != '\n'; )
+          {
+            if (!splice (i))
+              ++i;
+          }
+
+          ws = true;
+          continue;
+        }
+
+        if (c == '/' && i + 1 != n && s[i + 1] == '*')
+        {
+          size_t e (s.find ("*/", i + 2));
+          i = e != string::npos ? e + 2 : n;
+          ws = true;
+          continue;
+        }
+
+        if (c == '#' && bol)
+        {
+          // Make sure the directive starts on a new line.
+          //
+          if (!r.empty () && r.back () != '\n')
+            r += '\n';
+
+          ws = false;
+          dir = true;
+          bol = false;
+          r += c;
+          ++i;
+          continue;
+        }
+
+        bol = false;
+
+        // Literals (preserved verbatim).
+        //
+        if (c == '\'' && !ws && !r.empty ())
+        {
+          // Distinguish a digit separator (1'000) from a character literal
+          // with a prefix (u'x') by looking at the preceding token.
+          //
+          size_t b (r.size ());
+          while (b != 0 && word_char (r[b - 1]) &&
+                 r[b - 1] != '"' && r[b - 1] != '\'')
+            --b;
+
+          if (b != r.size () && r[b] >= '0' && r[b] <= '9')
+          {
+            r += c;
+            ++i;
+            continue;
+          }
+        }
+
+        if (c == '"' || c == '\'')
+        {
+          // Raw string literal (R"d(...)d", possibly prefixed).
+          //
+          if (c == '"' && !ws && !r.empty () && r.back () == 'R')
+          {
+            size_t p (s.find ('(', i + 1));
+
+            if (p != string::npos)
+            {
+              string e (')' + string (s, i + 1, p - i - 1) + '"');
+              size_t q (s.find (e, p + 1));
+              size_t j (q != string::npos ? q + e.size () : n);
+
+              emit (c);
+              r.append (s, i + 1, j - i - 1);
+              i = j;
+              continue;
+            }
+          }
+
+          size_t j (i + 1);
+          for (; j != n && s[j] != c && s[j] != '\n'; ++j)
+          {
+            if (s[j] == '\\' && j + 1 != n)
+              ++j;
+          }
+
+          if (j != n && s[j] == c)
+            ++j;
+
+          emit (c);
+          r.append (s, i + 1, j - i - 1);
+          i = j;
+          continue;
+        }
+
+        emit (c);
+        ++i;
+      }
+
+      return r;
+    }
+
+    // Normalize XML: drop comments and whitespace-only text between elements
+    // and collapse whitespace inside tags.
+    //
+    static string
+    normalize_xml (const string& s)
+    {
+      string r;
+      r.reserve (s.size ());
+
+      size_t n (s.size ());
+      bool open (false); // Last tag is a start tag.
+
+      auto space = [] (char c) {return c == '\n' || space_char (c);};
+
+      for (size_t i (0); i != n; )
+      {
+        if (s.compare (i, 4, "<!--") == 0)
+        {
+          size_t e (s.find ("-->", i + 4));
+          i = e != string::npos ? e + 3 : n;
+          continue;
+        }
+
+        if (s.compare (i, 9, "<![CDATA[") == 0)
+        {
+          size_t e (s.find ("]]>", i + 9));
+          size_t j (e != string::npos ? e + 3 : n);
+          r.append (s, i, j - i);
+          i = j;
+          continue;
+        }
+
+        if (s[i] == '<')
+        {
+          // Tag (including declarations and processing instructions).
+          //
+          char k (i + 1 != n ? s[i + 1] : '\0'); // End tag, declaration, etc.
+
+          bool ws (false);
+          for (; i != n; )
+          {
+            char c (s[i]);
+
+            if (space (c))
+            {
+              ws = true;
+              ++i;
+              continue;
+            }
+
+            if (c == '"' || c == '\'') // Attribute value.
+            {
+              size_t e (s.find (c, i + 1));
+              size_t j (e != string::npos ? e + 1 : n);
+
+              if (ws && r.back () != '=')
+                r += ' ';
+
+              r.append (s, i, j - i);
+              ws = false;
+              i = j;
+              continue;
+            }
+
+            // Drop whitespace around `=` and before the tag end.
+            //
+            if (ws && c != '=' && c != '>' && c != '/' && c != '?' &&
+                r.back () != '=')
+              r += ' ';
+
+            ws = false;
+            r += c;
+            ++i;
+
+            if (c == '>')
+              break;
+          }
+
+          // Note that an empty element (<x/>) is not a start tag.
+          //
+          open = k != '/' && k != '?' && k != '!' &&
+                 !(r.size () > 1 && r[r.size () - 2] == '/');
+
+          continue;
+        }
+
+        // Text: preserve verbatim unless whitespace-only and between
+        // elements. Note that whitespace-only text between the start and end
+        // tags of an element is its value (think <string> </string>).
+        //
+        size_t e (s.find ('<', i));
+        size_t j (e != string::npos ? e : n);
+
+        bool keep (open && s.compare (j, 2, "</") == 0);
+
+        for (size_t k (i); !keep && k != j; ++k)
+          keep = !space (s[k]);
+
+        if (keep)
+          r.append (s, i, j - i);
+
+        i = j;
+      }
+
+      return r;
+    }
+
+    string
+    fingerprint_normalize (const string& s, fingerprint_kind k)
+    {
+      return k == fingerprint_kind::cxx
+             ? normalize_cxx (s)
+             : normalize_xml (s);
+    }
+
+    string
+    fingerprint (const path& f, fingerprint_kind k)
+    {
+      string s;
+      try
+      {
+        ifdstream is (f, ifdstream::binary);
+        s = is.read_text ();
+        is.close ();
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to read " << f << ": " << e;
+      }
+
+      sha256 cs;
+      cs.append (fingerprint_normalize (s, k));
+      return cs.string ();
+    }
+
+    static inline string
+    mtime_string (timestamp t)
+    {
+      return to_string (t.time_since_epoch ().count ());
+    }
+
+    bool
+    fingerprint_unchanged (const path& ff,
+                           const path& in,
+                           timestamp mt,
+                           fingerprint_kind k,
+                           bool save)
+    {
+      tracer trace ("qt::fingerprint_unchanged");
+
+      // The fingerprint file format is as follows:
+      //
+      // <fingerprint>
+      // <input-mtime>
+      //
+      string fp, fmt;
+      try
+      {
+        if (!exists (ff))
+          return false;
+
+        ifdstream is (ff);
+        if (eof (getline (is, fp)) || eof (getline (is, fmt)))
+          return false;
+
+        is.close ();
+      }
+      catch (const io_error& e)
+      {
+        l4 ([&]{trace << "unable to read " << ff << ": " << e;});
+        return false;
+      }
+
+      if (fp.empty () || fmt.empty ())
+        return false;
+
+      string m (mtime_string (mt));
+
+      if (fmt == m) // Already verified.
+        return true;
+
+      if (fingerprint (in, k) != fp)
+        return false;
+
+      if (save)
+        fingerprint_save (ff, fp, mt);
+
+      return true;
+    }
+
+    void
+    fingerprint_save (const path& ff, const string& fp, timestamp mt)
+    {
+      tracer trace ("qt::fingerprint_save");
+
+      try
+      {
+        ofdstream os (ff);
+        os << fp << '\n'
+           << mtime_string (mt) << '\n';
+        os.close ();
+      }
+      catch (const io_error& e)
+      {
+        l4 ([&]{trace << "unable to write to " << ff << ": " << e;});
+        butl::try_rmfile (ff, true /* ignore_error */);
+      }
+    }
+
+    void
+    fingerprint_remove (const path& ff)
+    {
+      butl::try_rmfile (ff, true /* ignore_error */);
+    }
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Semantic fingerprints of the Qt compiler inputs (see
+    // config.qt.fingerprint for details).
+    //
+    // A fingerprint is the SHA256 checksum of the input's contents that is
+    // insensitive to the changes that cannot affect the compiler output:
+    //
+    // cxx -- C++ header or source file (moc input) with comments removed
+    //        and whitespace collapsed (except in the preprocessor
+    //        directives, where it is preserved as a single space, and in
+    //        literals, which are preserved verbatim).
+    //
+    // xml -- XML file (.ui and .qrc inputs) with comments and whitespace-
+    //        only text between elements removed and whitespace inside tags
+    //        collapsed (other text, including whitespace-only element
+    //        values, attribute values, and CDATA are preserved verbatim).
+    //
+    // Note that the normalization is conservative: some changes that cannot
+    // affect the output (for example, adding whitespace between two
+    // punctuators) still change the fingerprint.
+    //
+    enum class fingerprint_kind {cxx, xml};
+
+    LIBBUILD2_QT_SYMEXPORT string
+    fingerprint (const path&, fingerprint_kind);
+
+    // Return the normalized contents from which the fingerprint is
+    // calculated.
+    //
+    LIBBUILD2_QT_SYMEXPORT string
+    fingerprint_normalize (const string&, fingerprint_kind);
+
+    // The fingerprint of the input as of the last compiler run is stored in
+    // the fingerprint file (<output>.f) along with the input's modification
+    // time as of when the fingerprint was last verified (so that it doesn't
+    // need to be recalculated on every build if the input has only been
+    // touched).
+    //
+    // Return true if the input with the specified modification time has the
+    // same fingerprint as recorded in the fingerprint file and false if it
+    // differs or there is no (valid) fingerprint file. If true and save is
+    // true, then also record the new modification time.
+    //
+    LIBBUILD2_QT_SYMEXPORT bool
+    fingerprint_unchanged (const path& file,
+                           const path& input,
+                           timestamp input_mtime,
+                           fingerprint_kind,
+                           bool save);
+
+    // Write the fingerprint file. Failure to write it is not an error (the
+    // compiler will just be rerun next time).
+    //
+    LIBBUILD2_QT_SYMEXPORT void
+    fingerprint_save (const path& file,
+                      const string& fingerprint,
+                      timestamp input_mtime);
+
+    // Remove the fingerprint file if it exists (which is necessary if the
+    // compiler was run with fingerprints disabled since the file would no
+    // longer correspond to the output).
+    //
+    LIBBUILD2_QT_SYMEXPORT void
+    fingerprint_remove (const path& file);
+  }
+}
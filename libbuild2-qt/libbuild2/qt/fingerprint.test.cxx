@@ -0,0 +1,90 @@
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/qt/fingerprint.hxx>
+
+#undef NDEBUG
+#include <cassert>
+
+namespace build2
+{
+  namespace qt
+  {
+    static string
+    cxx (const string& s)
+    {
+      return fingerprint_normalize (s, fingerprint_kind::cxx);
+    }
+
+    static string
+    xml (const string& s)
+    {
+      return fingerprint_normalize (s, fingerprint_kind::xml);
+    }
+
+    int
+    main ()
+    {
+      // C++: comments.
+      //
+      assert (cxx ("a // x\nb") == "a b");
+      assert (cxx ("a/* x */b") == "a b");
+      assert (cxx ("a/* x */+b") == "a+b");
+      assert (cxx ("a // x\\\ny\nb") == "a b");
+
+      // C++: whitespace.
+      //
+      assert (cxx ("x = a  +  b ;") == "x=a+b;");
+      assert (cxx ("a + +b") == "a+ +b");
+      assert (cxx ("a ++b") == "a++b");
+      assert (cxx ("a\\\nb") == "ab");
+      assert (cxx ("1 .5") == "1 .5");
+      assert (cxx ("x. 5") == "x. 5");
+
+      // C++: preprocessor directives.
+      //
+      assert (cxx ("  #  define  X  1\nint y;") == "# define X 1\nint y;");
+      assert (cxx ("#define F (x)\n") == "#define F (x)\n");
+      assert (cxx ("#define F(x)\n") == "#define F(x)\n");
+
+      // C++: literals.
+      //
+      assert (cxx ("s = \"a  /* b */  c\";") == "s=\"a  /* b */  c\";");
+      assert (cxx ("s = \"a \\\" // b\";") == "s=\"a \\\" // b\";");
+      assert (cxx ("c = ' ';") == "c=' ';");
+      assert (cxx ("c = u'x';") == "c=u'x';");
+      assert (cxx ("n = 1'000'000;") == "n=1'000'000;");
+      assert (cxx ("r = R\"x( a  \" b )x\";") == "r=R\"x( a  \" b )x\";");
+      assert (cxx ("u8\"a\" \"b\"_s") == "u8\"a\" \"b\"_s");
+
+      // XML: comments.
+      //
+      assert (xml ("<a><!-- c --></a>") == "<a></a>");
+      assert (xml ("<a>x<!-- c -->y</a>") == "<a>xy</a>");
+
+      // XML: whitespace.
+      //
+      assert (xml ("<a>\n  <b/>\n</a>") == "<a><b/></a>");
+      assert (xml ("<a> <b/> </a>") == "<a><b/></a>");
+      assert (xml ("<a/> <b/>") == "<a/><b/>");
+      assert (xml ("<a  x = \"1  2\"  y='3' />") == "<a x=\"1  2\" y='3'/>");
+      assert (xml ("<?xml  version=\"1.0\"?>\n<a/>") ==
+              "<?xml version=\"1.0\"?><a/>");
+
+      // XML: text.
+      //
+      assert (xml ("<t> a  b </t>") == "<t> a  b </t>");
+      assert (xml ("<string> </string>") == "<string> </string>");
+      assert (xml ("<string> </string>") != xml ("<string></string>"));
+      assert (xml ("<![CDATA[ a  <b> ]]>") == "<![CDATA[ a  <b> ]]>");
+
+      return 0;
+    }
+  }
+}
+
+int
+main ()
+{
+  return build2::qt::main ();
+}
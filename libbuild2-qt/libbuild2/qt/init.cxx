@@ -9,6 +9,14 @@
 
 #include <libbuild2/cxx/target.hxx>
 
+#include <libbuild2/qt/probe.hxx>
+#include <libbuild2/qt/budget.hxx>
+#include <libbuild2/qt/change-journal.hxx>
+#include <libbuild2/qt/counters.hxx>
+#include <libbuild2/qt/timeline.hxx>
+#include <libbuild2/qt/event-trace.hxx>
+#include <libbuild2/qt/rebuild-log.hxx>
+
 #include <libbuild2/qt/moc/module.hxx>
 #include <libbuild2/qt/moc/target.hxx>
 #include <libbuild2/qt/moc/utility.hxx>
@@ -19,6 +27,9 @@
 #include <libbuild2/qt/uic/module.hxx>
 #include <libbuild2/qt/uic/target.hxx>
 
+#include <libbuild2/qt/qml/module.hxx>
+#include <libbuild2/qt/qml/target.hxx>
+
 namespace build2
 {
   namespace qt
@@ -54,6 +65,312 @@ namespace build2
       return v;
     }
 
+    // Budgets shared by all the projects of a context (see context_budget()).
+    //
+    static mutex budgets_mutex;
+    static map<pair<const context*, string>, std::weak_ptr<budget>> budgets;
+
+    // Return the budget with the specified name of the context, creating it
+    // with the specified capacity if it does not exist yet. The budget is
+    // kept alive by the modules of the context and so is destroyed together
+    // with the context.
+    //
+    // Note that if the projects of a context specify different capacities,
+    // then the one of the first project to create the budget is used.
+    //
+    static shared_ptr<budget>
+    context_budget (context& ctx, const string& name, uint64_t capacity)
+    {
+      mlock l (budgets_mutex);
+
+      // Remove the expired entries of the contexts that have been destroyed
+      // (whose addresses could otherwise be reused by new contexts).
+      //
+      for (auto i (budgets.begin ()); i != budgets.end (); )
+      {
+        if (i->second.expired ())
+          i = budgets.erase (i);
+        else
+          ++i;
+      }
+
+      std::weak_ptr<budget>& w (budgets[make_pair (&ctx, name)]);
+
+      shared_ptr<budget> r (w.lock ());
+      if (r == nullptr)
+      {
+        r = make_shared<budget> (capacity);
+        w = r;
+      }
+
+      return r;
+    }
+
+    // Enter the configuration variables that are common to all the qt
+    // modules and save their values in the module data. The location is
+    // that of the module loading (used for diagnostics).
+    //
+    template <typename D>
+    static void
+    config_common (scope& rs, D& d, const location& loc)
+    {
+      // The variable that we enter is qualified so go straight for the public
+      // variable pool.
+      //
+      variable_pool& vp (rs.var_pool (true /* public */));
+
+      //-
+      //     config.qt.trace [path]
+      //
+      // File to write the trace of the Qt compiler invocations (as well as
+      // of the automoc scan and depfile parsing phases) to, in the Chrome
+      // trace event format. The same file can be specified for multiple
+      // projects in which case their events end up in a single trace.
+      //
+      //-
+      {
+        const variable& var (vp.insert<path> ("config.qt.trace"));
+
+        if (const path* p = cast_null<path> (config::lookup_config (rs, var)))
+        {
+          if (!p->empty ())
+            d.etrace = event_trace::open (path (*p).complete ().normalize ());
+        }
+      }
+
+      //-
+      //     config.qt.timeline [bool]
+      //
+      // If true, record the timeline of the Qt code generation (automoc{}
+      // scans and moc, rcc, and uic runs) during update and print its
+      // summary (generation window, average parallelism, and the
+      // latest-finishing step) at the end of update.
+      //
+      //-
+      {
+        const variable& var (vp.insert<bool> ("config.qt.timeline"));
+
+        if (cast_false<bool> (config::lookup_config (rs, var)))
+          d.timeline = generation_timeline::open (rs);
+      }
+
+      //-
+      //     config.qt.max_processes [uint64]
+      //
+      // Maximum number of Qt compiler (moc, rcc, and uic) processes in
+      // flight. If specified, then a thread waiting for a Qt compiler
+      // process to complete is deactivated in the scheduler so that other
+      // threads can continue matching and compiling. As a result, there can
+      // be more Qt compiler processes in flight than there are active
+      // threads, up to this limit. The limit is shared by all the projects
+      // in the build. If unspecified, then the number of Qt compiler
+      // processes is bounded by the number of active threads (-j).
+      //
+      //-
+      {
+        const variable& var (vp.insert<uint64_t> ("config.qt.max_processes"));
+
+        if (const uint64_t* v =
+              cast_null<uint64_t> (config::lookup_config (rs, var)))
+        {
+          if (*v == 0)
+            fail (loc) << "invalid " << var << " value 0";
+
+          d.processes = context_budget (rs.ctx, "processes", *v);
+        }
+      }
+
+      //-
+      //     config.qt.stats [bool]
+      //
+      // If true, print the counters of the filesystem and process activity
+      // of the Qt rules (file stat calls, depdb lines read and written,
+      // dynamic dependency lookups, lexer tokens scanned, processes spawned,
+      // and bytes generated) as well as the summary of the reasons the
+      // targets were updated at the end of the update and clean operations
+      // (or at the end of the build if they don't go through the project's
+      // root directory). This information is also printed with verbosity
+      // level 3 or higher.
+      //
+      //-
+      {
+        const variable& var (vp.insert<bool> ("config.qt.stats"));
+
+        d.stats = cast_false<bool> (config::lookup_config (rs, var)) ||
+                  verb >= 3;
+      }
+    }
+
+    // Enter the fingerprint configuration variable and return its value.
+    //
+    // Note that this variable is not used by the qml module since the QML
+    // inputs are not fingerprinted (the C++ input normalization is not
+    // suitable for, say, JavaScript template literals).
+    //
+    static bool
+    fingerprint_config (scope& rs)
+    {
+      // The variable that we enter is qualified so go straight for the public
+      // variable pool.
+      //
+      variable_pool& vp (rs.var_pool (true /* public */));
+
+      //-
+      //     config.qt.fingerprint [bool]
+      //
+      // If true, then a change to the input file (moc header or source
+      // file, .ui file, or .qrc file) only causes the Qt compiler to be
+      // rerun if it changes the input's semantic fingerprint, that is, its
+      // contents with the comments and insignificant whitespace removed
+      // (see fingerprint.hxx for details). Changes to the other
+      // dependencies, options, etc., are handled as usual.
+      //
+      //-
+      const variable& var (vp.insert<bool> ("config.qt.fingerprint"));
+
+      return cast_false<bool> (config::lookup_config (rs, var));
+    }
+
+    // Enter the change journal configuration variable and return the
+    // journal or NULL if not used.
+    //
+    static shared_ptr<change_journal>
+    change_journal_config (scope& rs)
+    {
+      // The variable that we enter is qualified so go straight for the public
+      // variable pool.
+      //
+      variable_pool& vp (rs.var_pool (true /* public */));
+
+      //-
+      //     config.qt.change_journal [path]
+      //
+      // Change journal file maintained by the qt-change-journal watcher
+      // (Linux only). If specified, then the moc and rcc rules consult the
+      // journal to determine whether the recorded header and resource
+      // dependencies have changed instead of entering, matching, and
+      // checking the modification time of each of them. If the journal is
+      // missing or stale (the watcher is not running) or does not cover a
+      // dependency, then the modification time is checked as usual. The
+      // watched directories should only contain the source files (no output
+      // directories of in source builds and no symlinks to outside files).
+      //
+      //-
+      const variable& var (vp.insert<path> ("config.qt.change_journal"));
+
+      if (const path* p = cast_null<path> (config::lookup_config (rs, var)))
+      {
+        if (!p->empty ())
+          return change_journal::open (path (*p).complete ().normalize ());
+      }
+
+      return nullptr;
+    }
+
+    // Statistics of a rule (see register_statistics()).
+    //
+    struct rule_statistics
+    {
+      const char*    rule;
+      rule_counters& counters;
+      rebuild_log&   rebuilds;
+      const char*    rebuilt; // What happens to the logged targets.
+    };
+
+    // Printer of the counters and rebuild logs of the rules of a project
+    // (see register_statistics()).
+    //
+    struct statistics_printer
+    {
+      dir_path                out_root;
+      vector<rule_statistics> rss;
+
+      statistics_printer (dir_path o, vector<rule_statistics>&& r)
+          : out_root (move (o)), rss (move (r)) {}
+
+      void
+      print () const
+      {
+        {
+          diag_record dr;
+
+          for (const rule_statistics& s: rss)
+          {
+            if (s.counters.empty ())
+              continue;
+
+            if (dr.empty ())
+              dr << info << "qt rule counters for " << out_root;
+
+            s.counters.print (dr, s.rule);
+          }
+        }
+
+        {
+          diag_record dr;
+
+          for (const rule_statistics& s: rss)
+          {
+            if (s.rebuilds.empty ())
+              continue;
+
+            if (dr.empty ())
+              dr << info << "qt rebuild reasons for " << out_root;
+
+            s.rebuilds.print (dr, s.rule, s.rebuilt);
+          }
+        }
+      }
+
+      // Print what has been accumulated since the last root scope callback,
+      // if anything. This covers the operations that don't go through the
+      // project's root directory (for example, `b update: sub/`), in which
+      // case the statistics of all such operations performed in the build
+      // context are printed together at the end.
+      //
+      ~statistics_printer ()
+      {
+        print ();
+      }
+    };
+
+    // Register the root scope post operation callbacks that print the
+    // counters and rebuild logs of the specified rules at the end of update
+    // and clean if requested (see config.qt.stats). Return the printer that
+    // should be stored in the module (the statistics not printed by these
+    // callbacks are printed when it is destroyed) or NULL if not requested.
+    //
+    static shared_ptr<void>
+    register_statistics (scope& rs,
+                         bool enabled,
+                         vector<rule_statistics>&& rss)
+    {
+      if (!enabled)
+        return nullptr;
+
+      shared_ptr<statistics_printer> r (
+        make_shared<statistics_printer> (rs.out_path (), move (rss)));
+
+      // Note that the callbacks may outlive the module and so should not
+      // keep the printer alive.
+      //
+      auto print = [p = r.get ()] (action, const scope&, const dir&)
+      {
+        p->print ();
+        return target_state::unchanged;
+      };
+
+      rs.operation_callbacks.emplace (
+        perform_update_id,
+        scope::operation_callback {nullptr /* pre */, print});
+
+      rs.operation_callbacks.emplace (
+        perform_clean_id,
+        scope::operation_callback {nullptr /* pre */, print});
+
+      return r;
+    }
+
     // Information extracted from the compiler (moc, rcc, or uic).
     //
     // The environment is a list of environment variables that affect the
@@ -66,20 +383,214 @@ namespace build2
       const strings*                  cenv; // Compiler environment if any.
     };
 
+    // Cache of the Qt compilers imported in a build context.
+    //
+    // When many projects in the same context load the qt modules, importing
+    // the compilers (which may involve loading their projects or running
+    // them to extract the metadata) for each project is wasteful. So we
+    // cache the import results per context, keyed by the compiler name
+    // (which includes the Qt version), the outermost amalgamation, and the
+    // values of the configuration variables that affect the import (see
+    // import_key() for details).
+    //
+    // The cache is kept alive by the modules of the context (see
+    // data::import_cache) and is therefore destroyed together with the
+    // context (at which point its entry in the map below expires).
+    //
+    struct import_cache
+    {
+      map<string, import_result<exe>> entries;
+    };
+
+    static mutex import_caches_mutex;
+    static map<const context*, std::weak_ptr<import_cache>> import_caches;
+
+    // Return the import cache of the context, creating it if necessary.
+    //
+    static shared_ptr<import_cache>
+    context_import_cache (context& ctx)
+    {
+      mlock l (import_caches_mutex);
+
+      // Remove the expired entries of the contexts that have been destroyed
+      // (whose addresses could otherwise be reused by new contexts).
+      //
+      for (auto i (import_caches.begin ()); i != import_caches.end (); )
+      {
+        if (i->second.expired ())
+          i = import_caches.erase (i);
+        else
+          ++i;
+      }
+
+      std::weak_ptr<import_cache>& w (import_caches[&ctx]);
+
+      shared_ptr<import_cache> r (w.lock ());
+      if (r == nullptr)
+      {
+        r = make_shared<import_cache> ();
+        w = r;
+      }
+
+      return r;
+    }
+
+    // Return the import cache key for the compiler executable in the
+    // specified project (see import_cache for details).
+    //
+    static string
+    import_key (const scope& rs,
+                const string& pn,
+                const string& exe_name,
+                bool fallback)
+    {
+      ostringstream os;
+      os << exe_name << ' ' << rs.weak_scope ()->out_path ();
+
+      if (fallback)
+        os << " fallback";
+
+      // The config.import.* variables that can be used to specify the
+      // location of the compiler's project or the compiler itself (see
+      // import_search() for details).
+      //
+      const variable_pool& vp (rs.var_pool (true /* public */));
+
+      for (const string& n: {"config.import." + pn,
+                             "config.import." + pn + '.' + exe_name,
+                             "config.import." + pn + '.' + exe_name + ".exe"})
+      {
+        if (const variable* var = vp.find (n))
+        {
+          lookup l (rs[*var]);
+
+          if (l && !l->null)
+            os << ' ' << n << '=' << *l;
+        }
+      }
+
+      return os.str ();
+    }
+
+    // Return true if we should fall back to the system-installed Qt
+    // compilers if the import fails (see import_system_exe() for details).
+    //
+    static bool
+    system_fallback_enabled (scope& rs)
+    {
+      // The variable that we enter is qualified so go straight for the public
+      // variable pool.
+      //
+      variable_pool& vp (rs.var_pool (true /* public */));
+
+      //-
+      //     config.qt.system_fallback [bool]
+      //
+      // If true and a Qt compiler cannot be imported (normally as the
+      // Qt<ver><Name>%exe{qt<ver><name>} build2 package), then fall back to
+      // the system-installed upstream compiler found in PATH (moc-qt<ver>
+      // or moc, etc). The version of such a compiler is extracted by running
+      // it with --version and the results are cached in the
+      // build/qt/qt<ver><name>.probe file in the outermost amalgamation's
+      // out_root so that the compiler is only run again if it changes.
+      //
+      //-
+      const variable& var (vp.insert<bool> ("config.qt.system_fallback"));
+
+      return cast_false<bool> (config::lookup_config (rs, var));
+    }
+
+    // Enter the target for the system-installed Qt compiler found in PATH
+    // and set the metadata variables that would normally be set by the
+    // import (see probe_exe() for details).
+    //
+    // Return the import result with NULL target if not found. If the
+    // compiler found is of a different Qt version, then also set the
+    // mismatch argument to its path and version for diagnostics.
+    //
+    static import_result<exe>
+    import_system_exe (scope& rs,
+                       const string& name,
+                       const string& exe_name,
+                       uint64_t qt_ver,
+                       bool use_cache,
+                       string& mismatch)
+    {
+      tracer trace ("qt::import_system_exe");
+
+      context& ctx (rs.ctx);
+
+      import_result<exe> r;
+      r.target = nullptr;
+      r.kind = import_kind::fallback;
+
+      const scope& ws (*rs.weak_scope ());
+
+      optional<probe_result> pr (
+        probe_exe (ctx,
+                   name,
+                   qt_ver,
+                   ws.out_path () / ws.root_extra->build_dir /
+                   dir_path ("qt") / (exe_name + ".probe"),
+                   use_cache));
+
+      if (!pr)
+        return r;
+
+      // Note that the version has been verified by probe_exe() to be a
+      // valid standard version.
+      //
+      if (standard_version (pr->version).major () != qt_ver)
+      {
+        mismatch = pr->path.effect_string () + string (" is Qt ") +
+                   pr->version;
+        return r;
+      }
+
+      path p (pr->path.effect_string ());
+
+      exe& t (ctx.targets.insert<exe> (p.directory (),
+                                       dir_path (),
+                                       p.leaf ().base ().string (),
+                                       p.extension (),
+                                       trace));
+
+      if (t.path ().empty ())
+        t.path (p);
+
+      variable_pool& vp (rs.var_pool (true /* public */));
+
+      t.vars.assign (vp.insert<string> (exe_name + ".version")) =
+        move (pr->version);
+      t.vars.assign (vp.insert<string> (exe_name + ".checksum")) =
+        move (pr->checksum);
+
+      r.target = &t;
+      r.name = names {build2::name (t.dir, "exe", t.name)};
+      return r;
+    }
+
     // Import a Qt compiler and print the configuration report.
     //
     // Note that the compiler name is currently assumed to match the module
-    // name (e.g., `moc` and `qt.moc`).
+    // name (e.g., `moc` and `qt.moc`) except for the `qt.qml` module which
+    // has two compilers (`qmlcachegen` and `qmltc`).
     //
     // Return the compiler information or nullopt if the compiler was not
     // found.
     //
+    // Note that the import result is cached (see import_cache) except for
+    // the configure and disfigure meta-operations, where we need the import
+    // to be performed for each project in order for its configuration to be
+    // saved.
+    //
     static optional<compiler_info>
     import_exe (scope& rs,
                 const string& name, // Compiler name (`moc`/`rcc`/`uic`).
                 uint64_t qt_ver,    // Qt version (major).
                 const location& loc,
-                bool opt)
+                bool opt,
+                import_cache& cache)
     {
       string exe_name ("qt" + to_string (qt_ver) + name); // `qt5moc`
 
@@ -109,20 +620,69 @@ namespace build2
         //
         string pn ("Qt" + to_string (qt_ver) + ucase (name[0]) + &name[1]);
 
-        ir = import_direct<exe> (
-          new_cfg,
-          rs,
-          build2::name (move (pn), dir_path (), "exe", exe_name),
-          true, // phase2
-          opt,
-          true, // metadata
-          loc,
-          "module load");
+        const string& mn (rs.ctx.current_mname);
+        bool cacheable (mn != "configure" && mn != "disfigure");
+
+        bool fallback (system_fallback_enabled (rs));
+
+        string key;
+        if (cacheable)
+        {
+          key = import_key (rs, pn, exe_name, fallback);
+
+          mlock l (import_caches_mutex);
 
-        // @@ TODO: maybe/later fallback to system-installed upstream names
-        //    (`moc`/`rcc`/`uic`). To do this properly we will need to import
-        //    without metadata and then extract it in an ad hoc way (e.g., by
-        //    running the executable with --version, etc).
+          auto i (cache.entries.find (key));
+          if (i != cache.entries.end ())
+            ir = i->second;
+        }
+
+        if (ir.target == nullptr)
+        {
+          build2::name tn (pn, dir_path (), "exe", exe_name);
+
+          ir = import_direct<exe> (
+            new_cfg,
+            rs,
+            tn,
+            true, // phase2
+            opt || fallback,
+            true, // metadata
+            loc,
+            "module load");
+
+          // Fall back to the system-installed upstream compiler. Note that
+          // the upstream compilers don't support the build2 metadata
+          // protocol so we extract the metadata in an ad hoc way.
+          //
+          if (ir.target == nullptr && fallback)
+          {
+            // Re-probe on configure (see probe_exe() for details).
+            //
+            string mismatch;
+            ir = import_system_exe (rs, name, exe_name, qt_ver,
+                                    cacheable, mismatch);
+
+            if (ir.target == nullptr && !opt)
+            {
+              diag_record dr (fail (loc));
+              dr << "unable to import target " << tn;
+
+              if (mismatch.empty ())
+                dr << info << "no system-installed " << name
+                   << " found in PATH";
+              else
+                dr << info << "system-installed " << mismatch << " while "
+                   << "Qt " << qt_ver << " is expected";
+            }
+          }
+
+          if (cacheable && ir.target != nullptr)
+          {
+            mlock l (import_caches_mutex);
+            cache.entries.emplace (move (key), ir);
+          }
+        }
       }
 
       const exe* tgt (ir.target);
@@ -182,6 +742,41 @@ namespace build2
       }
     }
 
+    // Return true if the Qt compiler import should be deferred until the
+    // compiler is first used (see lazy_import for details).
+    //
+    static bool
+    lazy_import_enabled (scope& rs, bool opt)
+    {
+      // The variable that we enter is qualified so go straight for the public
+      // variable pool.
+      //
+      variable_pool& vp (rs.var_pool (true /* public */));
+
+      //-
+      //     config.qt.lazy_import [bool]
+      //
+      // If true, defer importing the Qt compilers (and extracting their
+      // metadata) until they are first needed to update a target rather
+      // than doing it when the module is loaded. This speeds up the
+      // invocations that load many projects but only update a few of them.
+      // Note that in this mode the qt.{moc,rcc,uic}* variables (compiler
+      // target, version, checksum) are not set during load. The compilers
+      // are always imported during load in the configure and disfigure
+      // meta-operations (so that their configuration is saved) as well as
+      // when the module is loaded optionally (since it's not known whether
+      // the compiler is available).
+      //
+      //-
+      const variable& var (vp.insert<bool> ("config.qt.lazy_import"));
+
+      if (!cast_false<bool> (config::lookup_config (rs, var)))
+        return false;
+
+      const string& mn (rs.ctx.current_mname);
+      return !opt && mn != "configure" && mn != "disfigure";
+    }
+
     // The `qt.moc.guess` module.
     //
     bool
@@ -206,9 +801,13 @@ namespace build2
       {
         optional<compiler_info> ci;
 
-        if (v != 0)
+        shared_ptr<import_cache> cache (context_import_cache (rs.ctx));
+
+        bool lazy (v != 0 && lazy_import_enabled (rs, opt));
+
+        if (v != 0 && !lazy)
         {
-          ci = import_exe (rs, "moc", v, loc, opt);
+          ci = import_exe (rs, "moc", v, loc, opt, *cache);
 
           if (!ci)
             return false;
@@ -222,11 +821,34 @@ namespace build2
         //
         string cenv_csum;
         if (ci->cenv != nullptr)
-          hash_environment (*ci->cenv);
+          cenv_csum = hash_environment (*ci->cenv);
 
-        extra.set_module (new module (data {v, ci->ctgt, ci->csum,
+        extra.set_module (new module (data {v, ci->ctgt, &ci->csum.get (),
                                             ci->cenv, move (cenv_csum),
                                             nullptr}));
+
+        extra.module_as<module> ().import_cache = move (cache);
+
+        if (lazy)
+        {
+          module& m (extra.module_as<module> ());
+
+          m.lazy = make_shared<lazy_import> (
+            [&rs, v, &m, l = location_value (loc)] ()
+            {
+              compiler_info ci (
+                *import_exe (rs, "moc", v, l, false /* opt */,
+                             *static_pointer_cast<import_cache> (
+                               m.import_cache)));
+
+              m.ctgt = ci.ctgt;
+              m.csum = &ci.csum.get ();
+              m.cenv = ci.cenv;
+
+              if (m.cenv != nullptr)
+                m.cenv_csum = hash_environment (*m.cenv);
+            });
+        }
       }
       else
       {
@@ -305,6 +927,21 @@ namespace build2
         //
         vp.insert<bool> ("qt.moc.include_with_quotes");
 
+        // If false, clean automoc{} groups without matching (and thus
+        // cleaning) their input header and source files. Default is true.
+        //
+        vp.insert<bool> ("qt.moc.automoc_clean_inputs");
+
+        // If true, scan the input for Qt meta-object macros before running
+        // moc and skip running it if there are none. Default is false.
+        //
+        vp.insert<bool> ("qt.moc.prefilter");
+
+        // If true, also produce the metatypes JSON file (<output>.json) for
+        // collecting into metatypes{}. Default is false.
+        //
+        vp.insert<bool> ("qt.moc.output_json");
+
         // Configuration.
         //
         // config.qt.moc.options
@@ -315,6 +952,21 @@ namespace build2
 
         if (m.cenv != nullptr)
           config::save_environment (rs, *m.cenv);
+
+        // config.qt.trace
+        // config.qt.timeline
+        // config.qt.max_processes
+        // config.qt.stats
+        //
+        config_common (rs, m, loc);
+
+        // config.qt.change_journal
+        //
+        m.journal = change_journal_config (rs);
+
+        // config.qt.fingerprint
+        //
+        m.fingerprint = fingerprint_config (rs);
       }
 
       return true;
@@ -357,6 +1009,9 @@ namespace build2
 
         if (m.cxx_mod == nullptr)
           fail (loc) << "cxx module must be loaded before qt.moc module";
+
+        m.predefs = predefs_cache::open (rs.ctx);
+        m.scans = scan_cache::open (rs);
       }
 
       // Load the cxx.predefs module if automatic predefs are enabled.
@@ -383,6 +1038,29 @@ namespace build2
             perform_clean_id,
             scope::operation_callback {&clean_sidebuilds, nullptr /*post*/});
 
+        // Save the automoc{} scan cache at the end of update (see also
+        // ~scan_cache() for the updates that bypass this callback).
+        //
+        rs.operation_callbacks.emplace (
+          perform_update_id,
+          scope::operation_callback {
+            nullptr /* pre */,
+            [scans = m.scans] (action, const scope&, const dir&)
+            {
+              scans->save ();
+              return target_state::unchanged;
+            }});
+
+        m.statistics = register_statistics (
+          rs, m.stats,
+          {{"qt.moc.compile",
+            m.compile_rule::counters, m.compile_rule::rebuilds, "updated"},
+           {"qt.moc.automoc",
+            m.automoc_rule::counters, m.automoc_rule::rebuilds, "rescanned"},
+           {"qt.moc.metatypes",
+            m.metatypes_rule::counters, m.metatypes_rule::rebuilds,
+            "merged"}});
+
         // Register target types and rules.
         //
 
@@ -396,8 +1074,12 @@ namespace build2
         //                  prerequisite headers and source files for the
         //                  presence of Qt meta-object macros.
         //
+        //   `metatypes{}` -- JSON file with the metatypes collected from
+        //                    the prerequisite moc outputs.
+        //
         rs.insert_target_type<qt::moc::moc> ();
         rs.insert_target_type<qt::moc::automoc> ();
+        rs.insert_target_type<qt::moc::metatypes> ();
 
         //-
         // Rules:
@@ -410,8 +1092,12 @@ namespace build2
         //                       targets for those that match, and delegate
         //                       updating them to the qt.moc.compile rule.
         //
-        qt::moc::compile_rule& c (m);
-        qt::moc::automoc_rule& a (m);
+        //   `qt.moc.metatypes` -- Merge the metatypes JSON files of the
+        //                         prerequisite moc outputs.
+        //
+        qt::moc::compile_rule&   c (m);
+        qt::moc::automoc_rule&   a (m);
+        qt::moc::metatypes_rule& j (m);
 
         rs.insert_rule<cxx::cxx> (perform_update_id,   "qt.moc.compile", c);
         rs.insert_rule<cxx::cxx> (perform_clean_id,    "qt.moc.compile", c);
@@ -427,6 +1113,13 @@ namespace build2
           perform_clean_id,    "qt.moc.automoc", a);
         rs.insert_rule<qt::moc::automoc> (
           configure_update_id, "qt.moc.automoc", a);
+
+        rs.insert_rule<qt::moc::metatypes> (
+          perform_update_id,   "qt.moc.metatypes", j);
+        rs.insert_rule<qt::moc::metatypes> (
+          perform_clean_id,    "qt.moc.metatypes", j);
+        rs.insert_rule<qt::moc::metatypes> (
+          configure_update_id, "qt.moc.metatypes", j);
       }
 
       return true;
@@ -456,9 +1149,13 @@ namespace build2
       {
         optional<compiler_info> ci;
 
-        if (v != 0)
+        shared_ptr<import_cache> cache (context_import_cache (rs.ctx));
+
+        bool lazy (v != 0 && lazy_import_enabled (rs, opt));
+
+        if (v != 0 && !lazy)
         {
-          ci = import_exe (rs, "rcc", v, loc, opt);
+          ci = import_exe (rs, "rcc", v, loc, opt, *cache);
 
           if (!ci)
             return false;
@@ -468,7 +1165,26 @@ namespace build2
         else
           ci = compiler_info {nullptr, empty_string, nullptr};
 
-        extra.set_module (new module (data {v, ci->ctgt, ci->csum}));
+        extra.set_module (new module (data {v, ci->ctgt, &ci->csum.get ()}));
+
+        extra.module_as<module> ().import_cache = move (cache);
+
+        if (lazy)
+        {
+          module& m (extra.module_as<module> ());
+
+          m.lazy = make_shared<lazy_import> (
+            [&rs, v, &m, l = location_value (loc)] ()
+            {
+              compiler_info ci (
+                *import_exe (rs, "rcc", v, l, false /* opt */,
+                             *static_pointer_cast<import_cache> (
+                               m.import_cache)));
+
+              m.ctgt = ci.ctgt;
+              m.csum = &ci.csum.get ();
+            });
+        }
       }
       else
       {
@@ -513,11 +1229,60 @@ namespace build2
       //
       if (first)
       {
+        module& m (extra.module_as<module> ());
+
         // config.qt.rcc.options
         //
         // Note that we merge it into the corresponding qt.rcc.* variable.
         //
         config::append_config<strings> (rs, rs, "qt.rcc.options", nullptr);
+
+        // config.qt.trace
+        // config.qt.timeline
+        // config.qt.max_processes
+        // config.qt.stats
+        //
+        config_common (rs, m, loc);
+
+        // config.qt.change_journal
+        //
+        m.journal = change_journal_config (rs);
+
+        // config.qt.fingerprint
+        //
+        m.fingerprint = fingerprint_config (rs);
+
+        //-
+        //     config.qt.rcc.max_memory [uint64]
+        //
+        // Memory budget in megabytes for the concurrently running rcc
+        // processes of all the projects in the build. If specified, then an
+        // rcc run is only started if its estimated memory usage (based on
+        // the total size of its input and resource files as of the last
+        // update) fits into the budget, otherwise it waits for other rcc
+        // runs to finish without blocking the rest of the build. A run whose
+        // size is unknown (for example, the first update) is executed
+        // exclusively. If different projects specify different values, then
+        // the one of the first loaded project is used.
+        //
+        //-
+        {
+          variable_pool& vp (rs.var_pool (true /* public */));
+
+          const variable& var (
+            vp.insert<uint64_t> ("config.qt.rcc.max_memory"));
+
+          if (const uint64_t* v =
+                cast_null<uint64_t> (config::lookup_config (rs, var)))
+          {
+            if (*v == 0)
+              fail (loc) << "invalid " << var << " value 0";
+
+            m.memory = context_budget (rs.ctx,
+                                       "rcc.memory",
+                                       *v * 1024 * 1024);
+          }
+        }
       }
 
       return true;
@@ -575,6 +1340,10 @@ namespace build2
         rs.insert_rule<file> (perform_update_id,   "qt.rcc.compile", m);
         rs.insert_rule<file> (perform_clean_id,    "qt.rcc.compile", m);
         rs.insert_rule<file> (configure_update_id, "qt.rcc.compile", m);
+
+        m.statistics = register_statistics (
+          rs, m.stats,
+          {{"qt.rcc.compile", m.counters, m.rebuilds, "updated"}});
       }
 
       return true;
@@ -605,9 +1374,13 @@ namespace build2
       {
         optional<compiler_info> ci;
 
-        if (v != 0)
+        shared_ptr<import_cache> cache (context_import_cache (rs.ctx));
+
+        bool lazy (v != 0 && lazy_import_enabled (rs, opt));
+
+        if (v != 0 && !lazy)
         {
-          ci = import_exe (rs, "uic", v, loc, opt);
+          ci = import_exe (rs, "uic", v, loc, opt, *cache);
 
           if (!ci)
             return false;
@@ -617,7 +1390,26 @@ namespace build2
         else
           ci = compiler_info {nullptr, empty_string, nullptr};
 
-        extra.set_module (new module (data {v, ci->ctgt, ci->csum}));
+        extra.set_module (new module (data {v, ci->ctgt, &ci->csum.get ()}));
+
+        extra.module_as<module> ().import_cache = move (cache);
+
+        if (lazy)
+        {
+          module& m (extra.module_as<module> ());
+
+          m.lazy = make_shared<lazy_import> (
+            [&rs, v, &m, l = location_value (loc)] ()
+            {
+              compiler_info ci (
+                *import_exe (rs, "uic", v, l, false /* opt */,
+                             *static_pointer_cast<import_cache> (
+                               m.import_cache)));
+
+              m.ctgt = ci.ctgt;
+              m.csum = &ci.csum.get ();
+            });
+        }
       }
       else
       {
@@ -662,11 +1454,24 @@ namespace build2
       //
       if (first)
       {
+        module& m (extra.module_as<module> ());
+
         // config.qt.uic.options
         //
         // Note that we merge it into the corresponding qt.uic.* variable.
         //
         config::append_config<strings> (rs, rs, "qt.uic.options", nullptr);
+
+        // config.qt.trace
+        // config.qt.timeline
+        // config.qt.max_processes
+        // config.qt.stats
+        //
+        config_common (rs, m, loc);
+
+        // config.qt.fingerprint
+        //
+        m.fingerprint = fingerprint_config (rs);
       }
 
       return true;
@@ -727,6 +1532,290 @@ namespace build2
         rs.insert_rule<cxx::hxx> (perform_update_id,   "qt.uic.compile", m);
         rs.insert_rule<cxx::hxx> (perform_clean_id,    "qt.uic.compile", m);
         rs.insert_rule<cxx::hxx> (configure_update_id, "qt.uic.compile", m);
+
+        m.statistics = register_statistics (
+          rs, m.stats,
+          {{"qt.uic.compile", m.counters, m.rebuilds, "updated"}});
+      }
+
+      return true;
+    }
+
+    // The `qt.qml.guess` module.
+    //
+    bool
+    qml_guess_init (scope& rs,
+                    scope& bs,
+                    const location& loc,
+                    bool first,
+                    bool opt,
+                    module_init_extra& extra)
+    {
+      using namespace qml;
+
+      tracer trace ("qt::qml_guess_init");
+      l5 ([&]{trace << "for " << bs;});
+
+      // Adjust module config.build save priority (code generator).
+      //
+      config::save_module (rs, "qt.qml", 150);
+
+      uint64_t v (check_version (bs, loc, first));
+
+      // The ahead-of-time compilation of QML as done by the qmlcachegen
+      // and qmltc of Qt 5 is not supported.
+      //
+      if (v == 5)
+        fail (loc) << "qt.qml module requires Qt 6 (qt.version=6)";
+
+      if (first)
+      {
+        // The variable that we enter is qualified so go straight for the
+        // public variable pool.
+        //
+        variable_pool& vp (rs.var_pool (true /* public */));
+
+        //-
+        //     config.qt.qml.qmltc [bool]
+        //
+        // If true, then also import qmltc (the QML type compiler) and
+        // enable compiling QML documents to C++ classes. Default is false.
+        //
+        //-
+        bool tc (
+          cast_false<bool> (
+            config::lookup_config (rs,
+                                   vp.insert<bool> ("config.qt.qml.qmltc"))));
+
+        optional<compiler_info> ci, tci;
+
+        shared_ptr<import_cache> cache (context_import_cache (rs.ctx));
+
+        bool lazy (v != 0 && lazy_import_enabled (rs, opt));
+
+        if (v != 0 && !lazy)
+        {
+          ci = import_exe (rs, "qmlcachegen", v, loc, opt, *cache);
+
+          if (!ci)
+            return false;
+
+          assert (ci->ctgt != nullptr);
+
+          if (tc)
+          {
+            tci = import_exe (rs, "qmltc", v, loc, opt, *cache);
+
+            if (!tci)
+              return false;
+          }
+        }
+        else
+          ci = compiler_info {nullptr, empty_string, nullptr};
+
+        extra.set_module (
+          new module (data {v,
+                            ci->ctgt, &ci->csum.get (),
+                            tci ? tci->ctgt : nullptr,
+                            tci ? &tci->csum.get () : nullptr}));
+
+        extra.module_as<module> ().import_cache = move (cache);
+
+        if (lazy)
+        {
+          module& m (extra.module_as<module> ());
+
+          m.lazy = make_shared<lazy_import> (
+            [&rs, v, tc, &m, l = location_value (loc)] ()
+            {
+              import_cache& c (
+                *static_pointer_cast<import_cache> (m.import_cache));
+
+              compiler_info ci (
+                *import_exe (rs, "qmlcachegen", v, l,
+                             false /* opt */, c));
+
+              m.ctgt = ci.ctgt;
+              m.csum = &ci.csum.get ();
+
+              if (tc)
+              {
+                compiler_info tci (
+                  *import_exe (rs, "qmltc", v, l,
+                               false /* opt */, c));
+
+                m.tc_ctgt = tci.ctgt;
+                m.tc_csum = &tci.csum.get ();
+              }
+            });
+        }
+      }
+      else
+      {
+        module& m (extra.module_as<module> ());
+
+        if (v != m.version)
+          fail (loc) << "inconsistent qt.version value " << v << info
+                     << "previous value " << m.version;
+      }
+
+      return true;
+    }
+
+    // The `qt.qml.config` module.
+    //
+    bool
+    qml_config_init (scope& rs,
+                     scope& bs,
+                     const location& loc,
+                     bool first,
+                     bool opt,
+                     module_init_extra& extra)
+    {
+      using namespace qml;
+
+      tracer trace ("qt::qml_config_init");
+      l5 ([&]{trace << "for " << bs;});
+
+      if (opt)
+        fail (loc) << "qt.qml.config does not support optional loading";
+
+      // Load qt.qml.guess and share its module instance as ours.
+      //
+      {
+        auto m (load_module (rs, bs, "qt.qml.guess", loc, extra.hints));
+
+        if (first)
+          extra.module = move (m);
+      }
+
+      if (first)
+      {
+        module& m (extra.module_as<module> ());
+
+        // All the variables we enter are qualified so go straight for the
+        // public variable pool.
+        //
+        variable_pool& vp (bs.var_pool (true /* public */));
+
+        // Variables controlling the resource path under which a compiled
+        // QML document or JavaScript file is registered (and which must
+        // match its path in the resource collection):
+        //
+        // qt.qml.resource_prefix: Directory prefix of the resource path
+        //                         (the input file name is appended to it).
+        //                         Default is `/`.
+        //
+        // qt.qml.resource_path:   Complete resource path (normally
+        //                         target-specific). Overrides the prefix.
+        //
+        vp.insert<string> ("qt.qml.resource_prefix");
+        vp.insert<string> ("qt.qml.resource_path");
+
+        // The resource name of the loader. Default is qmlcache_<target> with
+        // the characters other than alphanumeric replaced with `_`.
+        //
+        vp.insert<string> ("qt.qml.resource_name");
+
+        // Configuration.
+        //
+        // config.qt.qml.options
+        // config.qt.qml.qmltc_options
+        //
+        // Note that we merge them into the corresponding qt.qml.* variables.
+        //
+        config::append_config<strings> (rs, rs, "qt.qml.options", nullptr);
+        config::append_config<strings> (
+          rs, rs, "qt.qml.qmltc_options", nullptr);
+
+        // config.qt.trace
+        // config.qt.timeline
+        // config.qt.max_processes
+        // config.qt.stats
+        //
+        config_common (rs, m, loc);
+      }
+
+      return true;
+    }
+
+    // The `qt.qml` module.
+    //
+    bool
+    qml_init (scope& rs,
+              scope& bs,
+              const location& loc,
+              bool first,
+              bool opt,
+              module_init_extra& extra)
+    {
+      using namespace qml;
+
+      tracer trace ("qt::qml_init");
+      l5 ([&]{trace << "for " << bs;});
+
+      if (opt)
+        fail (loc) << "qt.qml does not support optional loading";
+
+      // Load qt.qml.config and share its module instance as ours.
+      //
+      {
+        auto m (load_module (rs, bs, "qt.qml.config", loc, extra.hints));
+
+        if (first)
+          extra.module = move (m);
+      }
+
+      // Register target types and rules.
+      //
+      if (first)
+      {
+        // Make sure the cxx module has been loaded since we need its cxx{}
+        // and hxx{} target types.
+        //
+        if (!cast_false<bool> (rs["cxx.build.loaded"]))
+          fail (loc) << "cxx module must be loaded before qt.qml module";
+
+        module& m (extra.module_as<module> ());
+
+        //-
+        // Target types:
+        //
+        //   `qml{}` -- QML document.
+        //
+        //   `js{}`  -- JavaScript file (.js or, with explicit extension,
+        //              .mjs).
+        //
+        // Note that the loader's qrc{} prerequisites require the `qt.rcc`
+        // module.
+        //-
+        rs.insert_target_type<qml::qml> ();
+        rs.insert_target_type<qml::js> ();
+
+        //-
+        // Rules:
+        //
+        //   `qt.qml.compile` -- Compile a QML document or JavaScript file
+        //                       identified as the first `qml{}` or `js{}`
+        //                       prerequisite with qmlcachegen (or with
+        //                       qmltc if the target has an ad hoc `hxx{}`
+        //                       member).
+        //
+        //   `qt.qml.loader`  -- Generate the qmlcachegen loader for the
+        //                       `qrc{}` prerequisites. Only matched with
+        //                       this rule hint.
+        //-
+        rs.insert_rule<cxx::cxx> (perform_update_id,   "qt.qml.compile", m);
+        rs.insert_rule<cxx::cxx> (perform_clean_id,    "qt.qml.compile", m);
+        rs.insert_rule<cxx::cxx> (configure_update_id, "qt.qml.compile", m);
+
+        rs.insert_rule<cxx::cxx> (perform_update_id,   "qt.qml.loader", m);
+        rs.insert_rule<cxx::cxx> (perform_clean_id,    "qt.qml.loader", m);
+        rs.insert_rule<cxx::cxx> (configure_update_id, "qt.qml.loader", m);
+
+        m.statistics = register_statistics (
+          rs, m.stats,
+          {{"qt.qml.compile", m.counters, m.rebuilds, "updated"}});
       }
 
       return true;
@@ -763,6 +1852,9 @@ namespace build2
       {"qt.uic.guess",  nullptr, uic_guess_init},
       {"qt.uic.config", nullptr, uic_config_init},
       {"qt.uic",        nullptr, uic_init},
+      {"qt.qml.guess",  nullptr, qml_guess_init},
+      {"qt.qml.config", nullptr, qml_config_init},
+      {"qt.qml",        nullptr, qml_init},
       {"qt",            nullptr, qt_init},
       {nullptr,         nullptr, nullptr}
     };
@@ -28,11 +28,19 @@ namespace build2
     //   `qt.uic.config` -- load `qt.uic.guess` and set the rest of the variables.
     //   `qt.uic`        -- load `qt.uic.config` and register targets and rules.
     //
+    //   `qt.qml.guess`  -- set variables describing the qmlcachegen (and,
+    //                      optionally, qmltc) compilers.
+    //   `qt.qml.config` -- load `qt.qml.guess` and set the rest of the variables.
+    //   `qt.qml`        -- load `qt.qml.config` and register targets and rules.
+    //
     //   `qt`            -- load the `qt.moc`, `qt.rcc`, and `qt.uic` submodules.
     //
-    // Each of the `qt.{moc,rcc,uic}` modules split the configuration process
-    // into two parts: guessing the compiler information and the actual
-    // configuration. This allows adjusting configuration based on the
+    // Note that the `qt.qml` submodules (which require Qt 6) are not loaded
+    // by the `qt` module.
+    //
+    // Each of the `qt.{moc,rcc,uic,qml}` modules split the configuration
+    // process into two parts: guessing the compiler information and the
+    // actual configuration. This allows adjusting configuration based on the
     // compiler information by first loading the guess module.
     //
     // Note that only the qt.*.guess modules support optional loading. In the
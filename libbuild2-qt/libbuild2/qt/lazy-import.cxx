@@ -0,0 +1,27 @@
+#include <libbuild2/qt/lazy-import.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    void lazy_import::
+    operator() (context& ctx)
+    {
+      if (done_.load (memory_order_acquire))
+        return;
+
+      // Importing may load the compiler's project and create targets so it
+      // has to be done in the load phase. Since the load phase is exclusive,
+      // there can be no other thread importing at the same time but it may
+      // have been done by a thread that switched before us.
+      //
+      phase_switch ps (ctx, run_phase::load);
+
+      if (!done_.load (memory_order_relaxed))
+      {
+        import_ ();
+        done_.store (true, memory_order_release);
+      }
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/context.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Deferred import of a Qt compiler (see config.qt.lazy_import).
+    //
+    // The import function is expected to import the compiler and set the
+    // compiler information (target, checksum, etc) in the module data. It
+    // is called at most once, on the first use of the compiler, which
+    // normally happens while matching the first target that needs updating.
+    //
+    class LIBBUILD2_QT_SYMEXPORT lazy_import
+    {
+    public:
+      explicit
+      lazy_import (function<void ()> f): import_ (move (f)) {}
+
+      lazy_import (const lazy_import&) = delete;
+      lazy_import& operator= (const lazy_import&) = delete;
+
+      // Import the compiler unless already done. Must be called during the
+      // match phase (switches to the load phase to perform the import).
+      //
+      void
+      operator() (context&);
+
+    private:
+      function<void ()> import_;
+      atomic<bool> done_ {false};
+    };
+  }
+}
@@ -1,6 +1,7 @@
 #include <libbuild2/qt/moc/automoc-rule.hxx>
 
 #include <libbuild2/depdb.hxx>
+#include <libbuild2/dyndep.hxx>
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
@@ -10,9 +11,8 @@
 
 #include <libbuild2/bin/target.hxx>
 
-#include <libbuild2/cc/lexer.hxx>
-
 #include <libbuild2/qt/moc/target.hxx>
+#include <libbuild2/qt/moc/scanner.hxx>
 
 namespace build2
 {
@@ -20,6 +20,36 @@ namespace build2
   {
     namespace moc
     {
+      // The rule id of the depdb written by the earlier version of this rule
+      // which did not distinguish between the header and source file inputs
+      // (both were flagged with '1'). Such a depdb can still be used by the
+      // standard clean (which only needs to know whether an input contains
+      // moc macros) but not by the cheap clean (see apply() for details).
+      //
+      static const char rule_id_v1[] = "qt.moc.automoc 1";
+
+      // Return true if the depdb exists and was written by the earlier
+      // version of this rule.
+      //
+      static bool
+      depdb_v1 (const path& f)
+      {
+        try
+        {
+          if (!exists (f))
+            return false;
+
+          ifdstream is (f);
+
+          string l;
+          return !eof (getline (is, l)) && l == rule_id_v1;
+        }
+        catch (const system_error&) // Includes io_error.
+        {
+          return false; // Let the depdb diagnose it.
+        }
+      }
+
       bool automoc_rule::
       match (action a, target& t) const
       {
@@ -76,12 +106,13 @@ namespace build2
           pts.pop_back ();
         }
 
-        // Extra prerequisites to be propagated to the moc rule: libraries and
-        // ad hoc headers.
+        // Extra prerequisites to be shared with the members: libraries and
+        // ad hoc headers (see automoc::extras for details).
         //
-        vector<prerequisite> extras;
+        vector<prerequisite>& extras (g.extras);
+        extras.clear ();
 
-        auto inject_member = [&ctx, &g, &extras] (const path_target& pt)
+        auto inject_member = [&ctx, &g] (const path_target& pt)
         {
           // Derive the moc output name and target type.
           //
@@ -104,12 +135,12 @@ namespace build2
             return;
           }
 
-          // Prepare member's prerequisites: the input header or source file
-          // and all of the ad hoc headers and library prerequisites.
+          // Prepare member's prerequisites: just the input header or source
+          // file. The ad hoc headers and library prerequisites are shared via
+          // the group (see automoc::extras).
           //
-          prerequisites ps {prerequisite (pt)};
-          for (const prerequisite& p: extras)
-            ps.push_back (p);
+          prerequisites ps;
+          ps.push_back (prerequisite (pt));
 
           // Search for an existing target or create a new one.
           //
@@ -239,12 +270,13 @@ namespace build2
           //    prerequisites of dependencies that we synthesize).
           //
           // 2. Scan the input sources and headers for meta-object macros
-          //    ("moc macros"). For each of those that contain such macros we
-          //    synthesize a moc output target and dependency, make the target
-          //    a member, and match the moc compile rule.
+          //    ("moc macros"), starting with those that are up to date while
+          //    the rest are being updated. For each of those that contain
+          //    such macros we synthesize a moc output target and dependency,
+          //    make the target a member, and match the moc compile rule.
 
-          // Match and update the input header and source file prerequisites
-          // and collect ad hoc headers and library prerequisites.
+          // Match the input header and source file prerequisites and collect
+          // ad hoc headers and library prerequisites.
           //
           // Note that we have to do this in the direct mode since we don't
           // know whether perform() will be executed or not.
@@ -318,9 +350,73 @@ namespace build2
               match_direct_complete (a, *pt);
           }
 
-          // Update the input header and source file prerequisites.
+          // Sort pts to ensure prerequisites line up with their depdb
+          // entries.
+          //
+          // Note that it is certain at this point that everything in pts are
+          // path_target's.
+          //
+          sort (pts.begin (), pts.end (),
+                [] (const prerequisite_target& x, const prerequisite_target& y)
+                {
+                  // Note: we have observed the match of all these targets so
+                  // we can use the relaxed memory order for path().
+                  //
+                  return x->as<path_target> ().path (memory_order_relaxed) <
+                         y->as<path_target> ().path (memory_order_relaxed);
+                });
+
+          // If the members were resolved on update during an earlier
+          // operation in this context (for example, `b update test` or
+          // update-for-install after update), the inputs are the same, and
+          // none of them need updating, then the depdb walk and scan would
+          // yield the same members and so we carry them over.
+          //
+          // Note that the member targets, their prerequisites, and the
+          // output directory are all still in place.
+          //
+          if (g.members_on != 0                     &&
+              g.members_on != ctx.current_on        &&
+              g.members_action == perform_update_id &&
+              g.inputs.size () == pts.size ()       &&
+              equal (pts.begin (), pts.end (), g.inputs.begin (),
+                     [a] (const prerequisite_target& p, const target* i)
+                     {
+                       return p.target == i &&
+                              i->matched_state (a) == target_state::unchanged;
+                     }))
+          {
+            l5 ([&]{trace << "reusing " << g.members.size () << " members of "
+                          << g;});
+
+            g.reuse_members ();
+            match_members ();
+
+            return &perform;
+          }
+
+          // Mark the input header and source file prerequisites that need
+          // updating (they are updated below). Note that we have to do this
+          // before switching the phase since we cannot call matched_state()
+          // after.
+          //
+          // Note also that this is update_during_match_prerequisites() with
+          // the scan interleaved (see below).
           //
-          update_during_match_prerequisites (trace, a, g, 0);
+          vector<size_t> pending; // Indexes of inputs being updated.
+
+          for (size_t i (0); i != pts.size (); ++i)
+          {
+            prerequisite_target& p (pts[i]);
+
+            if (p->matched_state (a) != target_state::unchanged)
+            {
+              p.data = 1;
+              pending.push_back (i);
+            }
+            else
+              p.data = 0;
+          }
 
           // Discover group members (moc outputs).
           //
@@ -348,44 +444,166 @@ namespace build2
           //
           //   <macro-flag> <path>
           //
-          // The flag is '1' if the file contains moc macros and '0' if not.
-          // The scan results are terminated by a blank line.
+          // The flag is '0' if the file does not contain moc macros and '1'
+          // or '2' if it does and is a header or source file, respectively
+          // (the latter allows to recreate the members without matching the
+          // inputs; see the clean below). The scan results are terminated by
+          // a blank line.
           //
           // For example:
           //
-          //   qt.moc.automoc 1
+          //   qt.moc.automoc 2
           //   1 /tmp/foo/hasmoc.h
+          //   2 /tmp/foo/hasmoc.cpp
           //   0 /tmp/foo/nomoc.h
           //
           //   ^@
           //
+          // Trace the scan phase (see below).
+          //
+          event_trace::span es (etrace.get ());
+          timestamp ts (timeline != nullptr
+                        ? system_clock::now ()
+                        : timestamp_unknown);
+          size_t scanned (0);
+
+          // The reason for switching to the scan mode (see rebuild_log).
+          //
+          optional<rebuild_cause> cause;
+
           depdb dd (dd_path);
 
           // If the rule name and/or version does not match we will be doing
           // an unconditional scan below.
           //
           if (dd.expect (rule_id_) != nullptr)
+          {
             l4 ([&]{trace << "rule mismatch forcing rescan of " << g;});
+            update_cause (cause, rebuild_reason::rule);
+          }
+          counters.depdb_line (dd);
 
-          // Sort pts to ensure prerequisites line up with their depdb
-          // entries.
+          if (dd.writing ())
+            update_cause (cause, rebuild_reason::depdb);
+
+          // Scan the input for moc macros returning true if any were found.
           //
-          // Note that it is certain at this point that everything in pts are
-          // path_target's.
+          // Note that we first consult the project-wide scan cache in case
+          // this file has already been scanned as part of another group (see
+          // scan_cache for details).
           //
-          sort (pts.begin (), pts.end (),
-                [] (const prerequisite_target& x, const prerequisite_target& y)
+          auto scan_input = [this, &scanned] (const path& f, timestamp mt)
+          {
+            uint64_t sz (event_trace::file_size (f));
+            rule_counters::increment (counters.stats);
+
+            if (scans != nullptr)
+            {
+              if (optional<bool> r = scans->find (f, mt, sz))
+                return *r;
+            }
+
+            ++scanned;
+
+            uint64_t tn (0); // Number of tokens scanned.
+            bool r (scan_moc_macros (f, &tn));
+
+            rule_counters::increment (counters.tokens, tn);
+
+            if (scans != nullptr)
+              scans->insert (f, mt, sz, r);
+
+            return r;
+          };
+
+          // Update the inputs that need updating, if any, and, while they
+          // are being updated, scan the ones that are already up to date
+          // (including those whose update has completed in the meantime)
+          // rather than waiting for the slowest of them before scanning
+          // anything.
+          //
+          // Note that these scans are speculative in the sense that we
+          // don't yet know which inputs the depdb walk below will end up
+          // scanning so we only scan those that are newer than the depdb
+          // (which are the ones that it will most likely scan). Note also
+          // that we stop scanning as soon as all the updates have completed
+          // and scan the rest in the match phase below since staying in the
+          // execute phase blocks matching on all the other threads.
+          //
+          vector<optional<bool>> pre; // Speculative scan results (by index).
+
+          if (!pending.empty ())
+          {
+            pre.resize (pts.size ());
+
+            bool all (dd.writing ()); // Everything will be scanned.
+            timestamp dmt (dd.mtime);
+
+            auto speculate = [&pts, &pre, &scan_input, all, dmt] (size_t i)
+            {
+              const path_target& pt (pts[i]->as<path_target> ());
+              timestamp mt (pt.load_mtime ());
+
+              if (all || mt > dmt)
+                pre[i] = scan_input (pt.path (memory_order_relaxed), mt);
+            };
+
+            phase_switch ps (ctx, run_phase::execute);
+
+            // Note that the group's task count is expected to be busy (since
+            // we are in match) and can be used for execute (see
+            // update_during_match_prerequisites() for details).
+            //
+            size_t busy (ctx.count_busy ());
+            size_t exec (ctx.count_executed ());
+            atomic_count& tc (g[a].task_count);
+
+            wait_guard wg (ctx, busy, tc);
+
+            for (size_t i: pending)
+              execute_direct_async (a, *pts[i], busy, tc);
+
+            // Scan the inputs whose update has completed and return true if
+            // there are still inputs being updated.
+            //
+            auto poll = [a, exec, &pts, &pending, &speculate] ()
+            {
+              for (auto i (pending.begin ()); i != pending.end (); )
+              {
+                if ((*pts[*i])[a].task_count.load (memory_order_acquire) ==
+                    exec)
                 {
-                  // Note: we have observed the match of all these targets so
-                  // we can use the relaxed memory order for path().
-                  //
-                  return x->as<path_target> ().path (memory_order_relaxed) <
-                         y->as<path_target> ().path (memory_order_relaxed);
-                });
+                  speculate (*i);
+                  i = pending.erase (i);
+                }
+                else
+                  ++i;
+              }
 
-          for (const prerequisite_target& p: pts)
+              return !pending.empty ();
+            };
+
+            for (size_t i (0); i != pts.size () && poll (); ++i)
+            {
+              if (pts[i].data == 0)
+                speculate (i);
+            }
+
+            wg.wait ();
+
+            for (prerequisite_target& p: pts)
+            {
+              if (p.data != 0)
+              {
+                execute_complete (a, *p);
+                p.data = 0;
+              }
+            }
+          }
+
+          for (size_t i (0); i != pts.size (); ++i)
           {
-            const path_target& pt (p->as<path_target> ());
+            const path_target& pt (pts[i]->as<path_target> ());
             const path& ptp (pt.path (memory_order_relaxed)); // See above.
 
             // True if this prerequisite needs to be scanned and the result
@@ -399,13 +617,14 @@ namespace build2
             {
               // If we're still in the lookup mode, read the next line from
               // the depdb and switch to scan mode if necessary; otherwise
-              // skip the prerequisite if its depdb macro flag is false (i.e.,
-              // don't add its moc output as member).
+              // skip the prerequisite if its depdb macro flag is false
+              // (i.e., don't add its moc output as member).
               //
               string* l (dd.read ());
+              rule_counters::increment (counters.depdb_reads);
 
-              // Switch to scan mode if the depdb entry is invalid or a blank
-              // line or its path doesn't match the prerequisite's
+              // Switch to scan mode if the depdb entry is invalid or a
+              // blank line or its path doesn't match the prerequisite's
               // path. Otherwise check its mtime and depdb macro flag.
               //
               if (l == nullptr || l->size () < 3 ||
@@ -415,19 +634,25 @@ namespace build2
                                         ptp.string ().size ()) != 0)
               {
                 scan = true;
+                update_cause (cause, rebuild_reason::input, ptp.string ());
               }
               else
               {
                 // Get the prerequisite's mtime.
                 //
                 timestamp mt (pt.load_mtime ());
+                rule_counters::increment (counters.stats);
 
                 // Switch to the scan mode if the prerequisite is newer than
                 // the depdb; otherwise skip the prerequisite if its depdb
                 // macro flag is false.
                 //
                 if (mt > dd.mtime)
+                {
                   scan = true;
+                  update_cause (cause,
+                                rebuild_reason::dependency, ptp.string ());
+                }
                 else
                 {
                   if (l->front () == '0')
@@ -438,50 +663,22 @@ namespace build2
               }
             }
 
-            // Scan the prerequisite for moc macros if necessary and write the
-            // result to the depdb. Skip the prerequisite if no macros were
-            // found (i.e., don't add its moc output as member).
-            //
-            // @@ TODO: one day, maybe we could do this in parallel?
+            // Scan the prerequisite for moc macros if necessary (unless
+            // already done speculatively; see above) and write the result to
+            // the depdb. Skip the prerequisite if no macros were found (i.e.,
+            // don't add its moc output as member).
             //
             if (scan)
             {
-              using namespace build2::cc; // lexer, token, token_type
-
-              ifdstream is (ifdstream::badbit);
-              try
-              {
-                is.open (ptp);
-              }
-              catch (const io_error& e)
-              {
-                fail << "unable to open file " << ptp << ": " << e;
-              }
-
-              bool macro (false); // True if a moc macro was found.
-
-              path_name pn (ptp);
-              lexer l (is, pn, false /* preprocessed */);
+              bool macro (!pre.empty () && pre[i]
+                          ? *pre[i]
+                          : scan_input (ptp, pt.load_mtime ()));
 
-              for (token t (l.next ());
-                   t.type != token_type::eos;
-                   t = l.next ())
-              {
-                if (t.type == token_type::identifier)
-                {
-                  if (t.value == "Q_OBJECT"    ||
-                      t.value == "Q_GADGET"    ||
-                      t.value == "Q_NAMESPACE" ||
-                      t.value == "Q_NAMESPACE_EXPORT")
-                  {
-                    macro = true;
-                    break;
-                  }
-                }
-              }
-
-              dd.write (macro ? "1 " : "0 ", false);
+              dd.write (!macro             ? "0 " :
+                        pt.is_a<hxx> () ? "1 " : "2 ",
+                        false);
               dd.write (ptp);
+              rule_counters::increment (counters.depdb_writes);
 
               if (!macro)
                 continue;
@@ -495,11 +692,125 @@ namespace build2
 
           // Write the blank line terminating the list of paths.
           //
-          dd.expect ("");
+          // If there are depdb entries left, then some inputs were removed.
+          //
+          if (dd.expect ("") != nullptr)
+            update_cause (cause, rebuild_reason::input);
+          counters.depdb_line (dd);
           dd.close (false /* mtime_check */);
 
+          if (stats && cause)
+            rebuilds.record (g, *cause);
+
+          if (timeline != nullptr)
+            timeline->record (g, "automoc", ts, system_clock::now ());
+
+          if (es)
+          {
+            es.complete ("qt.moc", "automoc " + g.name,
+                         event_trace::arguments ()
+                         ("group", g.dir.representation () + g.name)
+                         ("inputs", pts.size ())
+                         ("scanned", scanned)
+                         ("members", g.members.size ())
+                         ("reason", (cause
+                                     ? reason_name (cause->reason)
+                                     : "none")));
+          }
+
+          // Save the inputs for reuse_members() (see above). Note that we
+          // only do this once the members have been fully resolved.
+          //
+          g.inputs.reserve (pts.size ());
+          for (const prerequisite_target& p: pts)
+            g.inputs.push_back (p.target);
+
           match_members ();
         }
+        else if (!cast_true<bool> (g["qt.moc.automoc_clean_inputs"]) &&
+                 !depdb_v1 (dd_path))
+        {
+          // Clean without matching the input header and source file
+          // prerequisites (and thus without cleaning them) or collecting the
+          // ad hoc header and library prerequisites: recreate the members
+          // based solely on the information saved in depdb (see update above
+          // for its format). Their input files are entered as targets based
+          // on their paths and types recorded in depdb and the members only
+          // get the input file prerequisite, which is all that's necessary
+          // to clean them.
+          //
+          const scope& bs (g.base_scope ());
+
+          g.reset_members (a);
+
+          depdb dd (dd_path, true /* read_only */);
+
+          while (dd.reading ()) // Breakout loop.
+          {
+            string* l;
+            auto read = [this, &dd, &l] () -> bool
+            {
+              rule_counters::increment (counters.depdb_reads);
+              return (l = dd.read ()) != nullptr;
+            };
+
+            if (!read ()) // Rule id.
+              break;
+
+            if (*l != rule_id_)
+              fail << "unable to clean target " << g
+                   << " with old dependency database";
+
+            for (;;)
+            {
+              if (!read ())
+                break;
+
+              if (l->empty () || l->size () < 3)
+                break; // Done or invalid line.
+
+              if (l->front () == '0')
+                continue;
+
+              const target_type& tt (l->front () == '1'
+                                     ? hxx::static_type
+                                     : cxx::static_type);
+
+              // Note that the path type is already known so we don't map the
+              // extension (which may be ambiguous; think .h).
+              //
+              auto map_ext = [&tt] (const scope&, const string&, const string&)
+              {
+                return small_vector<const target_type*, 2> {&tt};
+              };
+
+              path f (*l, 2, l->size () - 2);
+
+              const build2::file* ft (
+                dyndep_rule::enter_file (trace, "input",
+                                         a, bs, g,
+                                         f,
+                                         true /* cache */,
+                                         true /* normalized */,
+                                         map_ext, tt).first);
+
+              if (ft != nullptr && (ft->is_a<hxx> () || ft->is_a<cxx> ()))
+                inject_member (*ft);
+            }
+
+            break;
+          }
+
+          match_members ();
+
+          // See below.
+          //
+          if (!ctx.match_only)
+            rmfile (ctx, dd_path, 2 /* verbosity */);
+
+          if (dir != nullptr)
+           fsdir_rule::perform_clean_direct (a, *dir);
+        }
         else // perform_clean_id
         {
           // It's a bit fuzzy whether we should also clean the input header
@@ -625,15 +936,19 @@ namespace build2
           while (dd.reading ()) // Breakout loop.
           {
             string* l;
-            auto read = [&dd, &l] () -> bool
+            auto read = [this, &dd, &l] () -> bool
             {
+              rule_counters::increment (counters.depdb_reads);
               return (l = dd.read ()) != nullptr;
             };
 
             if (!read ()) // Rule id.
               break;
 
-            if (*l != rule_id_)
+            // Note that the input flags of the earlier version of the
+            // depdb are compatible (see rule_id_v1 for details).
+            //
+            if (*l != rule_id_ && *l != rule_id_v1)
               fail << "unable to clean target " << g
                    << " with old dependency database";
 
@@ -692,7 +1007,7 @@ namespace build2
               // Inject a member for this prerequisite if it contains moc
               // macros.
               //
-              if (l->front () == '1')
+              if (l->front () != '0')
                 inject_member (pt->as<path_target> ());
             }
 
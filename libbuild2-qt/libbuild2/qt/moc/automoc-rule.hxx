@@ -10,6 +10,8 @@
 
 #include <libbuild2/qt/export.hxx>
 
+#include <libbuild2/qt/moc/rule.hxx> // data
+
 namespace build2
 {
   namespace qt
@@ -21,10 +23,13 @@ namespace build2
       // those that match, and delegate updating them to the qt.moc.compile
       // rule.
       //
-      class LIBBUILD2_QT_SYMEXPORT automoc_rule: public simple_rule
+      class LIBBUILD2_QT_SYMEXPORT automoc_rule: public simple_rule,
+                                                 private virtual data
       {
       public:
-        automoc_rule (): rule_id_ ("qt.moc.automoc 1") {}
+        explicit
+        automoc_rule (data&& d)
+            : data (move (d)), rule_id_ ("qt.moc.automoc 2") {}
 
         virtual bool
         match (action, target&) const override;
@@ -35,6 +40,9 @@ namespace build2
         static target_state
         perform (action, const target&);
 
+        mutable rule_counters counters;
+        mutable rebuild_log   rebuilds;
+
       private:
         const char* rule_id_;
 
@@ -0,0 +1,417 @@
+#include <libbuild2/qt/moc/metatypes-rule.hxx>
+
+#include <libbuild2/depdb.hxx>
+#include <libbuild2/target.hxx>
+#include <libbuild2/context.hxx>
+#include <libbuild2/algorithm.hxx>
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/qt/moc/target.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace moc
+    {
+      bool metatypes_rule::
+      match (action a, target& t) const
+      {
+        tracer trace ("qt::moc::metatypes_rule::match");
+
+        // Note that we don't want to resolve the automoc{} members here.
+        //
+        for (prerequisite_member p:
+               group_prerequisite_members (a, t, members_mode::never))
+        {
+          if (include (a, t, p) != include_type::normal) // Excluded/ad hoc.
+            continue;
+
+          if (p.is_a<cxx> () || p.is_a<moc> () || p.is_a<automoc> ())
+            return true;
+        }
+
+        l4 ([&]{trace << "no moc output for target " << t;});
+        return false;
+      }
+
+      recipe metatypes_rule::
+      apply (action a, target& xt) const
+      {
+        file& t (xt.as<file> ());
+
+        t.derive_path ("json"); // Note: no default extension (see target.cxx).
+
+        // Inject dependency on the output directory.
+        //
+        inject_fsdir (a, t);
+
+        // Match prerequisites (which resolves the automoc{} members).
+        //
+        match_prerequisite_members (a, t);
+
+        switch (a)
+        {
+        case perform_update_id: return [this] (action a, const target& t)
+          {
+            return perform_update (a, t);
+          };
+        case perform_clean_id:  return &perform_clean_depdb;
+        default:                return noop_recipe; // Configure/dist update.
+        }
+      }
+
+      // Read the file, failing if unable to.
+      //
+      static string
+      read_file (const path& f)
+      {
+        try
+        {
+          ifdstream is (f);
+          string r (is.read_text ());
+          is.close ();
+          return r;
+        }
+        catch (const io_error& e)
+        {
+          fail << "unable to read " << f << ": " << e << endf;
+        }
+      }
+
+      target_state metatypes_rule::
+      perform_update (action a, const target& xt) const
+      {
+        tracer trace ("qt::moc::metatypes_rule::perform_update");
+
+        context& ctx (xt.ctx);
+
+        const file& t (xt.as<file> ());
+        const path& tp (t.path ());
+
+        timestamp mt (t.load_mtime ());
+        rule_counters::increment (counters.stats);
+
+        // Note that the prerequisites' states don't tell us whether the
+        // result has changed (see below).
+        //
+        straight_execute_prerequisites (a, t);
+
+        // Collect the metatypes JSON files (fragments) of the moc outputs,
+        // sorted by path for a stable result.
+        //
+        struct fragment
+        {
+          path                fp;     // Fragment path (<output>.json).
+          const build2::file* output;
+          bool                reuse;  // Take from the previous result.
+        };
+
+        vector<fragment> fs;
+
+        for (const prerequisite_target& p: t.prerequisite_targets[a])
+        {
+          const target* pt (p.target);
+
+          if (pt != nullptr && (pt->is_a<cxx> () || pt->is_a<moc> ()))
+          {
+            const build2::file& o (pt->as<build2::file> ());
+            fs.push_back (fragment {o.path () + ".json", &o, false});
+          }
+        }
+
+        sort (fs.begin (), fs.end (),
+              [] (const fragment& x, const fragment& y) {return x.fp < y.fp;});
+
+        fs.erase (unique (fs.begin (), fs.end (),
+                          [] (const fragment& x, const fragment& y)
+                          {
+                            return x.fp == y.fp;
+                          }),
+                  fs.end ());
+
+        // The result is a JSON array of the (non-empty) fragments in the
+        // following layout:
+        //
+        // [\n
+        // <fragment>,\n
+        // ...
+        // <fragment>\n
+        // ]\n
+        //
+        // The depdb contains the fragments of the previous result (in the
+        // <size> <path> form and in the same order) which allows us to
+        // locate them in the previous result.
+        //
+        struct entry
+        {
+          size_t offset;
+          size_t size;
+        };
+
+        optional<rebuild_cause> cause;
+        map<path, entry> prev;
+        size_t prev_size (4); // Size of the previous result.
+
+        depdb dd (tp + ".d");
+        {
+          // First should come the rule name/version.
+          //
+          if (dd.expect ("qt.moc.metatypes 1") != nullptr)
+          {
+            l4 ([&]{trace << "rule mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::rule);
+          }
+          counters.depdb_line (dd);
+
+          // Then the fragments, terminated with a blank line.
+          //
+          for (size_t off (2); !dd.writing (); )
+          {
+            string* l (dd.read ());
+            rule_counters::increment (counters.depdb_reads);
+
+            if (l != nullptr && l->empty ())
+              break;
+
+            size_t p (l != nullptr ? l->find (' ') : string::npos);
+            uint64_t n (0);
+
+            if (p != string::npos && p != 0)
+            {
+              try
+              {
+                n = stoull (string (*l, 0, p));
+              }
+              catch (const std::exception&) // invalid_argument, out_of_range
+              {
+                p = string::npos;
+              }
+            }
+
+            if (p == string::npos || p == 0)
+            {
+              prev.clear ();
+              update_cause (cause, rebuild_reason::invalid);
+              break;
+            }
+
+            prev.emplace (path (string (*l, p + 1)),
+                          entry {off, static_cast<size_t> (n)});
+
+            if (n != 0)
+            {
+              off += n + 2;
+              prev_size = off + 1;
+            }
+          }
+        }
+
+        bool valid (!cause); // Previous result can be reused.
+
+        // A fragment can be taken from the previous result if its moc output
+        // is older than the depdb (which is written after the result; see
+        // below). Note that we require it to be strictly older in case of a
+        // coarse modification time resolution.
+        //
+        size_t reused (0);
+        bool same (valid && prev.size () == fs.size ()); // Same fragments.
+
+        for (fragment& f: fs)
+        {
+          if (valid && prev.find (f.fp) != prev.end ())
+          {
+            if (f.output->load_mtime () < dd.mtime)
+            {
+              f.reuse = true;
+              ++reused;
+            }
+          }
+          else
+            same = false;
+        }
+
+        if (same && reused == fs.size () && mt != timestamp_nonexistent)
+        {
+          dd.close ();
+          return target_state::unchanged;
+        }
+
+        if (!cause)
+        {
+          using r = rebuild_reason;
+
+          update_cause (cause,
+                        (mt == timestamp_nonexistent ? r::output     :
+                         same                        ? r::dependency :
+                         r::input));
+        }
+
+        if (ctx.dry_run)
+        {
+          if (verb)
+            print_diag ("collect", t);
+
+          dd.close ();
+          return target_state::changed;
+        }
+
+        event_trace::span es (etrace.get ());
+
+        // Read the previous result if there is anything to reuse and fall
+        // back to reading all the fragments if it's not what we expect.
+        //
+        string pr;
+
+        if (mt != timestamp_nonexistent)
+          pr = read_file (tp);
+
+        if (reused != 0 && (pr.size () != prev_size ||
+                            pr.compare (0, 2, "[\n") != 0))
+        {
+          l4 ([&]{trace << "unexpected " << tp << " layout, reading all "
+                        << "metatypes files";});
+
+          for (fragment& f: fs)
+            f.reuse = false;
+
+          reused = 0;
+        }
+
+        // Merge.
+        //
+        string r ("[\n");
+        vector<size_t> sizes;
+        sizes.reserve (fs.size ());
+
+        for (const fragment& f: fs)
+        {
+          string c;
+
+          if (f.reuse)
+          {
+            const entry& e (prev.find (f.fp)->second);
+            c.assign (pr, e.offset, e.size);
+          }
+          else
+          {
+            try
+            {
+              ifdstream is (f.fp);
+              c = is.read_text ();
+              is.close ();
+            }
+            catch (const io_error& e)
+            {
+              diag_record dr (fail);
+              dr << "unable to read metatypes file " << f.fp << ": " << e;
+
+              if (!exists (f.fp))
+                dr << info << "is qt.moc.output_json set to true for "
+                   << *f.output << "?";
+            }
+
+            while (!c.empty () && (c.back () == '\n' || c.back () == '\r' ||
+                                   c.back () == ' '  || c.back () == '\t'))
+              c.pop_back ();
+          }
+
+          sizes.push_back (c.size ());
+
+          if (!c.empty ())
+          {
+            if (r.size () != 2)
+              r += ",\n";
+
+            r += c;
+          }
+        }
+
+        if (r.size () != 2)
+          r += '\n';
+
+        r += "]\n";
+
+        // Only write the result if it has changed.
+        //
+        bool changed (mt == timestamp_nonexistent || r != pr);
+
+        if (changed)
+        {
+          if (stats && cause)
+            rebuilds.record (t, *cause);
+
+          if (verb >= 2)
+            text << "collect " << fs.size () << " metatypes files into " << tp;
+          else if (verb)
+            print_diag ("collect", t);
+
+          try
+          {
+            ofdstream os (tp);
+            os << r;
+            os.close ();
+          }
+          catch (const io_error& e)
+          {
+            fail << "unable to write to " << tp << ": " << e;
+          }
+
+          rule_counters::increment (counters.bytes, r.size ());
+        }
+        else
+          l5 ([&]{trace << "metatypes unchanged, not updating " << t;});
+
+        // Write the fragments to the depdb unless they are the same (same
+        // paths and sizes) as in the previous one, in which case only update
+        // its modification time so that the re-read fragments are reused
+        // next time (see above).
+        //
+        bool rewrite (!valid || !same);
+
+        for (size_t i (0); !rewrite && i != fs.size (); ++i)
+          rewrite = prev.find (fs[i].fp)->second.size != sizes[i];
+
+        if (!rewrite)
+          dd.touch = timestamp_unknown;
+
+        dd.close ();
+
+        if (rewrite)
+        {
+          depdb nd (tp + ".d");
+          nd.expect ("qt.moc.metatypes 1");
+          counters.depdb_line (nd);
+
+          for (size_t i (0); i != fs.size (); ++i)
+          {
+            nd.write (to_string (sizes[i]) + ' ' + fs[i].fp.string ());
+            rule_counters::increment (counters.depdb_writes);
+          }
+
+          nd.expect ("");
+          counters.depdb_line (nd);
+          nd.close ();
+        }
+
+        if (es)
+        {
+          es.complete ("qt.moc", "collect " + tp.leaf ().string (),
+                       event_trace::arguments ()
+                       ("output", tp.string ())
+                       ("fragments", fs.size ())
+                       ("reused", reused)
+                       ("output_size", r.size ())
+                       ("changed", changed ? 1 : 0));
+        }
+
+        if (!changed)
+          return target_state::unchanged;
+
+        t.mtime (system_clock::now ());
+        return target_state::changed;
+      }
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/rule.hxx>
+
+#include <libbuild2/cxx/target.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+#include <libbuild2/qt/moc/rule.hxx> // data
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace moc
+    {
+      // Merge the metatypes JSON files produced by moc for a metatypes{}
+      // target's prerequisite moc outputs (see qt.moc.output_json) into a
+      // single JSON array, the equivalent of moc --collect-json.
+      //
+      // The merge is incremental: the fragments whose moc outputs have not
+      // changed since the last merge are taken from the previous result
+      // (their positions are recorded in the depdb) and only the changed
+      // ones are read. The result is only written if it has changed so
+      // that its dependents (for example, QML type registration) are not
+      // updated if, say, a change to a header didn't affect its metatypes.
+      //
+      class LIBBUILD2_QT_SYMEXPORT metatypes_rule: public simple_rule,
+                                                   private virtual data
+      {
+      public:
+        explicit
+        metatypes_rule (data&& d): data (move (d)) {}
+
+        virtual bool
+        match (action, target&) const override;
+
+        virtual recipe
+        apply (action, target&) const override;
+
+        target_state
+        perform_update (action, const target&) const;
+
+        mutable rule_counters counters;
+        mutable rebuild_log   rebuilds;
+
+      private:
+        using cxx = build2::cxx::cxx;
+      };
+    }
+  }
+}
@@ -7,6 +7,7 @@
 
 #include <libbuild2/qt/moc/rule.hxx>
 #include <libbuild2/qt/moc/automoc-rule.hxx>
+#include <libbuild2/qt/moc/metatypes-rule.hxx>
 
 namespace build2
 {
@@ -17,10 +18,22 @@ namespace build2
       class module: public build2::module,
                     public virtual data,
                     public compile_rule,
-                    public automoc_rule
+                    public automoc_rule,
+                    public metatypes_rule
       {
       public:
-        explicit module (data&& d): data (move (d)), compile_rule (move (d)) {}
+        explicit module (data&& d)
+            : data (move (d)),
+              compile_rule (move (d)),
+              automoc_rule (move (d)),
+              metatypes_rule (move (d))
+        {
+        }
+
+        // Printer of the rule statistics (see register_statistics() in
+        // init.cxx). Note: must be destroyed before the rules.
+        //
+        shared_ptr<void> statistics;
       };
     }
   }
@@ -12,6 +12,10 @@
 #include <libbuild2/bin/target.hxx>
 #include <libbuild2/bin/utility.hxx>
 
+#include <libbuild2/qt/run.hxx>
+
+#include <libbuild2/qt/moc/module.hxx>
+#include <libbuild2/qt/moc/scanner.hxx>
 #include <libbuild2/qt/moc/utility.hxx>
 
 namespace build2
@@ -41,6 +45,8 @@ namespace build2
 
         strings lib_opts; // Prerequisite library options.
 
+        optional<rebuild_cause> cause; // Set if the target needs updating.
+
         const compile_rule& rule;
 
         target_state
@@ -149,14 +155,23 @@ namespace build2
                    : reinterpret_cast<const target*> (p.data);
       }
 
-      // @@ TODO Handle plugin metadata json files specified via
-      //         Q_PLUGIN_METADATA macros. (This is the only other file type
-      //         supported besides headers and source files.)
+      // Besides headers and source files, the only other file type moc
+      // depends on are the plugin metadata JSON files specified with the
+      // Q_PLUGIN_METADATA macro's FILE argument (which moc lists in its
+      // depfile). Unless the project defines a target type for the json
+      // extension, map them to file{} rather than falling back to h{} so
+      // that they match an explicitly declared file{} target, if any.
       //
       static small_vector<const target_type*, 2>
       map_ext (const scope& bs, const string& n, const string& e)
       {
-        return dyndep_rule::map_extension (bs, n, e, nullptr);
+        small_vector<const target_type*, 2> r (
+          dyndep_rule::map_extension (bs, n, e, nullptr));
+
+        if (r.empty () && e == "json")
+          r.push_back (&file::static_type);
+
+        return r;
       }
 
       recipe compile_rule::
@@ -180,8 +195,12 @@ namespace build2
         //
         const fsdir* dir (inject_fsdir (a, t));
 
-        // For update inject dependency on the MOC compiler target.
+        // For update inject dependency on the MOC compiler target (importing
+        // it first if the import was deferred).
         //
+        if (a == perform_update_id && lazy != nullptr)
+          (*lazy) (t.ctx);
+
         if (a == perform_update_id && ctgt != nullptr)
           inject (a, t, *ctgt);
 
@@ -204,11 +223,124 @@ namespace build2
         // the path values and also clean_sidebuilds() which removes the side
         // build directory.
         //
-        auto auto_predefs = [&rs, &trace] () -> prerequisite_target
+        // Note that the header only depends on the C++ compiler and the
+        // options that affect the predefined macros. So if an outer project
+        // (amalgamation) also uses automatic predefs with the same compiler
+        // and options, then we use its header instead of extracting the same
+        // macros again. We pick the outermost such project which makes the
+        // choice independent of the order in which the projects are matched
+        // and means that cleaning a subproject does not remove the header
+        // used by others. Note also that the header search directories are
+        // the main reason the preprocessor options differ between projects
+        // and they don't affect the predefined macros, so we only consider
+        // the macro options.
+        //
+        // Note that the header has to be in a project that has the
+        // cxx.predefs rule registered and so we cannot place it into a
+        // location that is owned by the context as a whole. As a result, its
+        // path differs between the standalone and amalgamated builds of a
+        // project which is why it is included in the options checksum.
+        //
+        // Note that each value is hashed with its terminating '\0' and is
+        // preceded by the variable name so that, for example, the options
+        // split or concatenated differently or moved between variables
+        // produce different keys.
+        //
+        auto predefs_key = [] (const scope& rs) -> string
+        {
+          sha256 cs;
+
+          auto append = [&cs] (const string& s)
+          {
+            cs.append (s.c_str (), s.size () + 1);
+          };
+
+          for (const char* n: {"cxx.checksum", "cxx.std"})
+          {
+            if (const string* v = cast_null<string> (rs[n]))
+            {
+              append (n);
+              append (*v);
+            }
+          }
+
+          for (const char* n: {"cxx.mode", "cc.coptions", "cxx.coptions"})
+          {
+            if (const strings* v = cast_null<strings> (rs[n]))
+            {
+              append (n);
+
+              for (const string& o: *v)
+                append (o);
+            }
+          }
+
+          for (const char* n: {"cc.poptions", "cxx.poptions"})
+          {
+            if (const strings* v = cast_null<strings> (rs[n]))
+            {
+              append (n);
+
+              bool m (false); // Value of the preceding -D/-U.
+
+              for (const string& o: *v)
+              {
+                if (m                               ||
+                    o.compare (0, 2, "-D") == 0     ||
+                    o.compare (0, 2, "-U") == 0     ||
+                    o.compare (0, 2, "/D") == 0     ||
+                    o.compare (0, 2, "/U") == 0)
+                {
+                  append (o);
+                  m = !m && o.size () == 2;
+                }
+              }
+            }
+          }
+
+          return cs.string ();
+        };
+
+        auto auto_predefs = [this, &rs, &trace, &predefs_key] ()
+          -> prerequisite_target
         {
+          // See if we have already determined the header of this project.
+          //
+          if (predefs != nullptr)
+          {
+            mlock l (predefs->mutex_);
+
+            auto i (predefs->headers.find (&rs));
+            if (i != predefs->headers.end ())
+              return prerequisite_target (i->second,
+                                          include_type (include_type::adhoc));
+          }
+
+          // Find the outermost project (this or an amalgamation) that uses
+          // automatic predefs with the same compiler and options.
+          //
+          const scope* os (&rs); // Owner's root scope.
+          {
+            string k;
+            for (const scope* r (rs.parent_scope ()->root_scope ());
+                 r != nullptr;
+                 r = r->parent_scope ()->root_scope ())
+            {
+              if (r->find_module<module> ("qt.moc") != nullptr &&
+                  pass_moc_options (*r, "predefs"))
+              {
+                if (k.empty ())
+                  k = predefs_key (rs);
+
+                if (predefs_key (*r) == k)
+                  os = r;
+              }
+            }
+          }
+
           // The output directory. For example, out_root/build/qt/moc/build/.
           //
-          dir_path d (rs.out_path () / rs.root_extra->build_dir /
+          dir_path d (os->out_path () / os->root_extra->build_dir /
                       module_build_dir);
 
           const char* n ("predefs"); // Predefs target name.
@@ -247,7 +379,7 @@ namespace build2
                                              dir_path (),
                                              string (),
                                              string (),
-                                             rs)});
+                                             *os)});
 
               p.second.unlock ();
 
@@ -255,10 +387,10 @@ namespace build2
               // (see also clean_sidebuilds()).
               //
               auto insert_parent_fsdir =
-                [&rs, &trace] (dir_path&& d,
+                [os, &trace] (dir_path&& d,
                                const auto& insert_parent_fsdir) -> void
               {
-                auto p (rs.ctx.targets.insert_locked (
+                auto p (os->ctx.targets.insert_locked (
                           fsdir::static_type,
                           d,
                           dir_path (), // Always in the out tree.
@@ -277,11 +409,11 @@ namespace build2
                                                  dir_path (),
                                                  string (),
                                                  string (),
-                                                 rs)});
+                                                 *os)});
 
                   p.second.unlock ();
 
-                  if (d != rs.out_path ())
+                  if (d != os->out_path ())
                     insert_parent_fsdir (move (d), insert_parent_fsdir);
                 }
               };
@@ -292,6 +424,12 @@ namespace build2
             pt = &p.first;
           }
 
+          if (predefs != nullptr)
+          {
+            mlock l (predefs->mutex_);
+            predefs->headers.emplace (&rs, pt);
+          }
+
           return prerequisite_target (pt, include_type (include_type::adhoc));
         };
 
@@ -318,11 +456,8 @@ namespace build2
           //
           wait_guard wg (ctx, ctx.count_busy (), t[a].task_count, true);
 
-          // Note that we don't use group_prerequisite_members() because it
-          // would return the other members of the automoc{} group (also moc
-          // outputs) as prerequisites which would not be the right semantics.
-          //
-          for (prerequisite_member p: prerequisite_members (a, t))
+          auto add = [this, a, &t, &ctx, &rs, &pts, &usr_lib_dirs, dir,
+                      &is_lib] (const prerequisite_member& p, bool shared)
           {
             const target* pt (nullptr);
             include_type  pi (include (a, t, p));
@@ -330,12 +465,12 @@ namespace build2
             // Ignore excluded.
             //
             if (!pi)
-              continue;
+              return;
 
             if (pi == include_type::normal && is_lib (p.type ()))
             {
               if (a.operation () != update_id)
-                continue;
+                return;
 
               // Fail if this is a lib{} because we cannot possibly pick a
               // member and matching the group will most likely produce an
@@ -375,15 +510,45 @@ namespace build2
               // Don't add injected fsdir{} or compiler target twice.
               //
               if (pt == dir || pt == ctgt)
-                continue;
+                return;
 
               if (a.operation () == clean_id && !pt->in (rs))
-                continue;
+                return;
+            }
+
+            // Don't add the shared prerequisites twice if they are also
+            // specified for the member itself (see below).
+            //
+            if (shared)
+            {
+              for (const prerequisite_target& p: pts)
+                if (p.target == pt)
+                  return;
             }
 
             match_async (a, *pt, ctx.count_busy (), t[a].task_count);
 
             pts.emplace_back (pt, pi);
+          };
+
+          // Note that we don't use group_prerequisite_members() because it
+          // would return the other members of the automoc{} group (also moc
+          // outputs) as prerequisites which would not be the right semantics.
+          //
+          for (prerequisite_member p: prerequisite_members (a, t))
+            add (p, false /* shared */);
+
+          // If this is a member of an automoc{} group, then also add the
+          // library and ad hoc header prerequisites of the group, which are
+          // shared by all the members rather than copied to each (see
+          // automoc::extras for details).
+          //
+          if (const automoc* g = (t.group != nullptr
+                                  ? t.group->is_a<automoc> ()
+                                  : nullptr))
+          {
+            for (const prerequisite& p: g->extras)
+              add (prerequisite_member {p, nullptr}, true /* shared */);
           }
 
           // Also add and start matching the automatic predefs header if
@@ -393,12 +558,18 @@ namespace build2
           {
             prerequisite_target p (auto_predefs ());
 
-            match_async (a, *p, ctx.count_busy (), t[a].task_count);
-
-            // Note: The predefs header is expected by perform_update() to be
-            //       the pts_n'th element of pts.
+            // Don't clean the header of an outer project (see
+            // auto_predefs() for details).
             //
-            pts.push_back (p);
+            if (a.operation () != clean_id || p->in (rs))
+            {
+              match_async (a, *p, ctx.count_busy (), t[a].task_count);
+
+              // Note: The predefs header is expected by perform_update() to
+              //       be the pts_n'th element of pts.
+              //
+              pts.push_back (p);
+            }
           }
 
           wg.wait ();
@@ -438,7 +609,8 @@ namespace build2
         {
           return [] (action a, const target& t)
           {
-            return perform_clean_extra (a, t.as<file> (), {".d", ".t"});
+            return perform_clean_extra (a, t.as<file> (),
+                                        {".d", ".t", ".f", ".json"});
           };
         }
         else if (a != perform_update_id)
@@ -521,17 +693,29 @@ namespace build2
           // First should come the rule name/version.
           //
           if (dd.expect ("qt.moc.compile 1") != nullptr)
+          {
             l4 ([&]{trace << "rule mismatch forcing update of " << t;});
+            update_cause (md.cause, rebuild_reason::rule);
+          }
+          counters.depdb_line (dd);
 
           // Then the compiler checksum.
           //
-          if (dd.expect (csum) != nullptr)
+          if (dd.expect (*csum) != nullptr)
+          {
             l4 ([&]{trace << "compiler mismatch forcing update of " << t;});
+            update_cause (md.cause, rebuild_reason::compiler);
+          }
+          counters.depdb_line (dd);
 
           // Then the compiler environment checksum.
           //
           if (dd.expect (cenv_csum) != nullptr)
+          {
             l4 ([&]{trace << "environment mismatch forcing update of " << t;});
+            update_cause (md.cause, rebuild_reason::environment);
+          }
+          counters.depdb_line (dd);
 
           // Then the options checksum.
           //
@@ -540,6 +724,15 @@ namespace build2
 
             // Note: see below for the order.
             //
+            // Include the predefs header path since it depends on the
+            // project that owns the header (see auto_predefs() for details).
+            //
+            if (pass_moc_options (t, "predefs"))
+            {
+              const target* pt (get_target (pts[md.pts_n - 1]));
+              append_option (cs, pt->as<hxx> ().path ().string ().c_str ());
+            }
+
             append_options (cs, t, "qt.moc.options");
 
             // Include cc.poptions and cxx.poptions.
@@ -562,14 +755,35 @@ namespace build2
                 append_option (cs, d.string ().c_str ());
             }
 
+            // Include the prefilter in the checksum (only if enabled not to
+            // invalidate the existing databases) since the output produced
+            // in its place differs from the moc's output.
+            //
+            if (cast_false<bool> (t["qt.moc.prefilter"]))
+              append_option (cs, "prefilter");
+
+            // Same for the metatypes JSON output.
+            //
+            if (cast_false<bool> (t["qt.moc.output_json"]))
+              append_option (cs, "output_json");
+
             if (dd.expect (cs.string ()) != nullptr)
+            {
               l4 ([&]{trace << "options mismatch forcing update of " << t;});
+              update_cause (md.cause, rebuild_reason::options);
+            }
+            counters.depdb_line (dd);
           }
 
           // Finally the input file.
           //
           if (dd.expect (s.path ()) != nullptr)
+          {
             l4 ([&]{trace << "input file mismatch forcing update of " << t;});
+            update_cause (md.cause,
+                          rebuild_reason::input, s.path ().string ());
+          }
+          counters.depdb_line (dd);
         }
 
         // Determine if we need to do an update based on the above checks.
@@ -581,17 +795,31 @@ namespace build2
         {
           u = true;
           mt = timestamp_nonexistent;
+          update_cause (md.cause, rebuild_reason::depdb);
         }
         else
         {
           if ((mt = t.mtime ()) == timestamp_unknown)
+          {
             t.mtime (mt = mtime (tp));
+            rule_counters::increment (counters.stats);
+          }
 
-          u = dd.mtime > mt;
+          if ((u = dd.mtime > mt))
+            update_cause (md.cause,
+                          (mt == timestamp_nonexistent
+                           ? rebuild_reason::output
+                           : rebuild_reason::outdated));
         }
 
         // Update the static prerequisites.
         //
+        // If fingerprints are enabled and the input file is newer than the
+        // output, then we only check its fingerprint once we know nothing
+        // else has changed (see below).
+        //
+        bool fp_check (false);
+
         for (prerequisite_target& p: pts)
         {
           // Skip library prerequisites, both unmatched (never updated) and
@@ -600,7 +828,19 @@ namespace build2
           if (((p.include & include_unmatch) != 0) || is_lib (p->type ()))
             continue;
 
-          u = update (trace, a, *p.target, u ? timestamp_unknown : mt) || u;
+          if (update (trace, a, *p.target, u ? timestamp_unknown : mt) && !u)
+          {
+            if (fingerprint && p.target == &s)
+            {
+              fp_check = true;
+              continue;
+            }
+
+            u = true;
+            update_cause (md.cause,
+                          rebuild_reason::dependency,
+                          cause_detail (*p.target));
+          }
         }
 
         // Verify the header paths in the depdb unless we're already updating
@@ -614,9 +854,27 @@ namespace build2
           // Return true if the header has changed and nullopt if it does not
           // exist.
           //
-          auto add = [&trace, a, &bs, &t, mt, pts_n = md.pts_n] (path fp)
+          auto add = [this, &trace,
+                      a, &bs, &t, mt, pts_n = md.pts_n] (path fp)
             -> optional<bool>
           {
+            // If the change journal says the file has not changed since
+            // the output was produced, then skip entering and matching its
+            // target (see config.qt.change_journal for details).
+            //
+            if (journal != nullptr)
+            {
+              optional<bool> c (journal->changed (t.ctx, fp, mt));
+
+              if (c && !*c)
+              {
+                rule_counters::increment (counters.journal);
+                return false;
+              }
+            }
+
+            rule_counters::increment (counters.lookups);
+
             // If it is outside any project, or the project doesn't have such
             // an extension, assume it is a plain old C header.
             //
@@ -655,12 +913,14 @@ namespace build2
             // We should always end with a blank line.
             //
             string* l (dd.read ());
+            rule_counters::increment (counters.depdb_reads);
 
             // If the line is invalid, run moc.
             //
             if (l == nullptr)
             {
               u = true;
+              update_cause (md.cause, rebuild_reason::invalid);
               break;
             }
 
@@ -676,19 +936,54 @@ namespace build2
               md.skip_count++;
 
               if (*r)
+              {
                 u = true;
+                update_cause (md.cause, rebuild_reason::dependency, *l);
+              }
             }
             else
             {
               // Header does not exist. Invalidate this line and trigger
               // update.
               //
+              update_cause (md.cause, rebuild_reason::missing, *l);
+
               dd.write ();
+              rule_counters::increment (counters.depdb_writes);
               u = true;
             }
           }
         }
 
+        // If only the input file has changed, then check its fingerprint
+        // and only update if it has changed as well (see
+        // config.qt.fingerprint for details).
+        //
+        // Note that we leave the output (and thus its dependents) alone in
+        // this case, which means the input stays newer than the output. But
+        // we record its modification time in the fingerprint file so that
+        // the next time we don't need to recalculate the fingerprint.
+        //
+        if (!u && fp_check)
+        {
+          if (fingerprint_unchanged (tp + ".f",
+                                     s.path (), s.load_mtime (),
+                                     fingerprint_kind::cxx,
+                                     !ctx.dry_run_option))
+          {
+            l5 ([&]{trace << "fingerprint of " << s << " unchanged, not "
+                          << "updating " << t;});
+            rule_counters::increment (counters.fingerprint);
+          }
+          else
+          {
+            u = true;
+            update_cause (md.cause,
+                          rebuild_reason::dependency,
+                          cause_detail (s));
+          }
+        }
+
         // Note that during a dry run we may end up with an incomplete (but
         // valid) database, but it will be updated on the next non-dry run.
         //
@@ -780,6 +1075,116 @@ namespace build2
         if (md.mt != timestamp_nonexistent)
           return target_state::unchanged; // No need to update.
 
+        if (stats && md.cause)
+          rebuilds.record (t, *md.cause);
+
+        // If fingerprints are enabled, calculate the input's fingerprint
+        // before running moc and save it once the output has been produced
+        // (see fingerprint_unchanged() for details). Otherwise, remove the
+        // fingerprint file which would no longer match the output.
+        //
+        optional<string> fp;
+        timestamp fp_mt;
+
+        if (fingerprint && !ctx.dry_run)
+        {
+          fp_mt = s.load_mtime ();
+          fp = qt::fingerprint (sp, fingerprint_kind::cxx);
+        }
+
+        auto save_fingerprint = [&ctx, &tp, &fp, &fp_mt] ()
+        {
+          if (fp)
+            fingerprint_save (tp + ".f", *fp, fp_mt);
+          else if (!ctx.dry_run)
+            fingerprint_remove (tp + ".f");
+        };
+
+        // If requested, moc also produces the metatypes JSON file next to
+        // the output (see metatypes_rule for details). Otherwise, remove it
+        // if left over from a previous run so that it's not collected.
+        //
+        bool json (cast_false<bool> (t["qt.moc.output_json"]));
+
+        if (!json && !ctx.dry_run)
+          butl::try_rmfile (tp + ".json", true /* ignore_error */);
+
+        // If the prefilter is enabled and the input does not contain any
+        // meta-object macros, then moc would only issue a note and produce
+        // an output without any meta-object code. So produce such an output
+        // ourselves and skip running moc (see qt.moc.prefilter for details).
+        //
+        // Note that in this case the output depends on nothing but the input
+        // (a static prerequisite) so there are no header paths to write to
+        // the depdb. Any header paths that have been verified in apply() are
+        // kept (see skip_count) which can only cause an unnecessary check.
+        //
+        if (cast_false<bool> (t["qt.moc.prefilter"]))
+        {
+          uint64_t tn (0);
+          bool macro (scan_moc_macros (sp, &tn));
+
+          rule_counters::increment (counters.tokens, tn);
+
+          if (!macro)
+          {
+            if (verb >= 2)
+              text << "no meta-object macros in " << sp << ", not running moc";
+            else if (verb)
+              print_diag ("moc", s, t);
+
+            timestamp start (!ctx.dry_run && depdb::mtime_check ()
+                             ? system_clock::now ()
+                             : timestamp_unknown);
+
+            if (!ctx.dry_run)
+            {
+              try
+              {
+                ofdstream os (tp);
+                os << "// Generated by the qt.moc.compile rule: no Qt meta-"
+                   << "object macros in" << '\n'
+                   << "// " << sp.leaf ().string () << " so moc was not run."
+                   << '\n';
+                os.close ();
+
+                // Note that the metatypes of an input without any classes
+                // are represented with an empty file (which is skipped when
+                // collecting).
+                //
+                if (json)
+                  ofdstream (tp + ".json").close ();
+              }
+              catch (const io_error& e)
+              {
+                fail << "unable to write to " << tp << ": " << e;
+              }
+
+              depdb dd (move (md.dd));
+              dd.expect ("");
+              counters.depdb_line (dd);
+              dd.close ();
+
+              md.dd.path = move (dd.path); // For mtime check below.
+
+              rule_counters::increment (counters.prefilter);
+              rule_counters::increment (counters.bytes,
+                                        event_trace::file_size (tp));
+            }
+
+            save_fingerprint ();
+
+            timestamp now (system_clock::now ());
+
+            if (!ctx.dry_run)
+              depdb::check_mtime (start, md.dd.path, t.path (), now);
+
+            t.mtime (now);
+
+            return target_state::changed;
+          }
+        }
+
         // Prepare the moc command line.
         //
         const process_path& pp (ctgt->process_path ());
@@ -999,6 +1404,11 @@ namespace build2
         args.push_back ("--dep-file-path");
         args.push_back (depfile.string ().c_str ());
 
+        // Metatypes (written by moc to <output>.json).
+        //
+        if (json)
+          args.push_back ("--output-json");
+
         // Output path.
         //
         args.push_back ("-o");
@@ -1022,22 +1432,65 @@ namespace build2
                          : timestamp_unknown);
 
         if (!ctx.dry_run)
-          run (ctx, pp, args, 1 /* finish_verbosity */);
+        {
+          event_trace::span es (etrace.get ());
+          timestamp ts (timeline != nullptr
+                        ? system_clock::now ()
+                        : timestamp_unknown);
+
+          run_tool (ctx, pp, args, processes.get ());
+
+          // Note that the moc output of an automoc{} member can only be
+          // produced after the group scan.
+          //
+          if (timeline != nullptr)
+            timeline->record (t, "moc", ts, system_clock::now (),
+                              (t.group != nullptr && t.group->is_a<automoc> ()
+                               ? t.group
+                               : nullptr));
+
+          rule_counters::increment (counters.processes);
+          rule_counters::increment (counters.stats);
+          rule_counters::increment (counters.bytes,
+                                    event_trace::file_size (tp));
+
+          if (es)
+          {
+            event_trace::arguments ea;
+            ea ("input", sp.string ())
+               ("output", tp.string ())
+               ("argc", args.size () - 1)
+               ("input_size", event_trace::file_size (sp))
+               ("output_size", event_trace::file_size (tp));
+
+            if (md.cause)
+              ea ("reason", reason_name (md.cause->reason));
+
+            es.complete ("qt.moc", "moc " + sp.leaf ().string (), move (ea));
+          }
+        }
 
         // Write the header paths contained in the moc-generated depfile to
         // the depdb.
         //
         if (!ctx.dry_run)
         {
+          event_trace::span es (etrace.get ());
+
           depdb dd (move (md.dd));
           size_t skip (md.skip_count);
+          size_t n (0); // Number of dependencies (for the event trace).
 
           // Note that fp is expected to be absolute.
           //
-          auto add = [&trace,
+          auto add = [this, &trace,
                       a, &bs, &t, pts_n = md.pts_n,
-                      &dd, &skip] (path fp)
+                      &dd, &skip, &n] (path fp)
           {
+            ++n;
+
+            rule_counters::increment (counters.lookups);
+
             normalize_external (fp, "header");
 
             // If it is outside any project, or the project doesn't have such
@@ -1090,6 +1543,7 @@ namespace build2
             }
 
             dd.write (fp);
+            rule_counters::increment (counters.depdb_writes);
           };
 
           auto df = make_diag_frame (
@@ -1154,11 +1608,22 @@ namespace build2
           // Add the terminating blank line.
           //
           dd.expect ("");
+          counters.depdb_line (dd);
           dd.close ();
 
           md.dd.path = move (dd.path); // For mtime check below.
+
+          if (es)
+          {
+            es.complete ("qt.moc", "depfile " + depfile.leaf ().string (),
+                         event_trace::arguments ()
+                         ("depfile", depfile.string ())
+                         ("entries", n));
+          }
         }
 
+        save_fingerprint ();
+
         timestamp now (system_clock::now ());
 
         if (!ctx.dry_run)
@@ -12,7 +12,18 @@
 
 #include <libbuild2/qt/export.hxx>
 
+#include <libbuild2/qt/budget.hxx>
+#include <libbuild2/qt/change-journal.hxx>
+#include <libbuild2/qt/counters.hxx>
+#include <libbuild2/qt/lazy-import.hxx>
+#include <libbuild2/qt/event-trace.hxx>
+#include <libbuild2/qt/fingerprint.hxx>
+#include <libbuild2/qt/rebuild-log.hxx>
+#include <libbuild2/qt/timeline.hxx>
+
 #include <libbuild2/qt/moc/target.hxx>
+#include <libbuild2/qt/moc/utility.hxx>
+#include <libbuild2/qt/moc/scan-cache.hxx>
 
 namespace build2
 {
@@ -29,10 +40,45 @@ namespace build2
       {
         const uint64_t    version;   // qt.version
         const exe*        ctgt;      // Moc compiler target (NULL if load-only).
-        const string&     csum;      // Moc compiler checksum.
+        const string*     csum;      // Moc compiler checksum.
         const strings*    cenv;      // Moc compiler environment if any.
-        const string      cenv_csum; // Environment checksum.
+        string            cenv_csum; // Environment checksum.
         const cc::module* cxx_mod;   // The cxx module.
+
+        shared_ptr<event_trace> etrace; // Event trace (NULL if disabled).
+        shared_ptr<generation_timeline> timeline; // NULL if disabled.
+        bool stats = false;             // Print rule counters.
+        bool fingerprint = false;       // See config.qt.fingerprint.
+
+        // Limit on the number of Qt compiler processes in flight or NULL if
+        // unlimited (see config.qt.max_processes).
+        //
+        shared_ptr<budget> processes;
+
+        // Change journal to consult before checking the dynamic
+        // dependencies or NULL if not used (see config.qt.change_journal).
+        //
+        shared_ptr<change_journal> journal;
+
+        // Deferred compiler import or NULL if the compiler was imported when
+        // the module was loaded (see config.qt.lazy_import). If not NULL,
+        // then the compiler information above is only valid once it has
+        // been called.
+        //
+        shared_ptr<lazy_import> lazy;
+
+        // Keeps the context-wide cache of the imported compilers alive (see
+        // import_exe() in init.cxx for details).
+        //
+        shared_ptr<void> import_cache;
+
+        // Automatic predefs headers shared between projects.
+        //
+        shared_ptr<predefs_cache> predefs;
+
+        // Project-wide automoc{} scan results cache.
+        //
+        shared_ptr<scan_cache> scans;
       };
 
       class LIBBUILD2_QT_SYMEXPORT compile_rule: public rule,
@@ -54,6 +100,9 @@ namespace build2
         target_state
         perform_update (action, const target&, match_data&) const;
 
+        mutable rule_counters counters;
+        mutable rebuild_log   rebuilds;
+
         using h   = build2::c::h;
         using cxx = build2::cxx::cxx;
         using hxx = build2::cxx::hxx;
@@ -0,0 +1,214 @@
+#include <libbuild2/qt/moc/scan-cache.hxx>
+
+#include <libbuild2/context.hxx>
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/qt/moc/utility.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace moc
+    {
+      // The cache file starts with the format name and version followed by
+      // one entry per line, formatted as follows:
+      //
+      //   <macro-flag> <mtime> <size> <path>
+      //
+      static const char cache_id[] = "qt.moc.scan-cache 1";
+
+      // Scan caches of the projects loaded by this process (see open()).
+      //
+      static mutex caches_mutex;
+      static map<const scope*, std::weak_ptr<scan_cache>> caches;
+
+      shared_ptr<scan_cache> scan_cache::
+      open (const scope& rs)
+      {
+        mlock l (caches_mutex);
+
+        // Remove the expired entries of the projects that have been destroyed
+        // (whose addresses could otherwise be reused by new projects).
+        //
+        for (auto i (caches.begin ()); i != caches.end (); )
+        {
+          if (i->second.expired ())
+            i = caches.erase (i);
+          else
+            ++i;
+        }
+
+        std::weak_ptr<scan_cache>& w (caches[&rs]);
+
+        shared_ptr<scan_cache> r (w.lock ());
+        if (r == nullptr)
+        {
+          r = make_shared<scan_cache> (file (rs), rs.ctx.dry_run_option);
+          w = r;
+        }
+
+        return r;
+      }
+
+      path scan_cache::
+      file (const scope& rs)
+      {
+        return rs.out_path () / rs.root_extra->build_dir / module_dir /
+               "scan-cache";
+      }
+
+      scan_cache::
+      scan_cache (path p, bool dr)
+          : path_ (move (p)), dry_run_ (dr)
+      {
+      }
+
+      scan_cache::
+      ~scan_cache ()
+      {
+        save ();
+      }
+
+      static inline uint64_t
+      mtime_count (timestamp t)
+      {
+        return static_cast<uint64_t> (t.time_since_epoch ().count ());
+      }
+
+      optional<bool> scan_cache::
+      find (const path& p, timestamp mt, uint64_t sz)
+      {
+        mlock l (mutex_);
+
+        if (!loaded_)
+          load ();
+
+        auto i (entries_.find (p));
+
+        if (i == entries_.end ()                ||
+            i->second.mtime != mtime_count (mt) ||
+            i->second.size != sz)
+          return nullopt;
+
+        return i->second.macro;
+      }
+
+      void scan_cache::
+      insert (const path& p, timestamp mt, uint64_t sz, bool macro)
+      {
+        entry e {mtime_count (mt), sz, macro};
+
+        mlock l (mutex_);
+
+        if (!loaded_)
+          load ();
+
+        entries_[p] = e;
+        dirty_ = true;
+      }
+
+      void scan_cache::
+      load ()
+      {
+        tracer trace ("qt::moc::scan_cache::load");
+
+        loaded_ = true;
+
+        if (!exists (path_))
+          return;
+
+        try
+        {
+          ifdstream is (path_);
+
+          string l;
+          if (eof (getline (is, l)) || l != cache_id)
+          {
+            l4 ([&]{trace << "ignoring " << path_ << " with unknown format";});
+            return;
+          }
+
+          while (!eof (getline (is, l)))
+          {
+            // Parse `<macro-flag> <mtime> <size> <path>`, ignoring invalid
+            // lines.
+            //
+            size_t m (l.find (' ', 2));
+            size_t s (m != string::npos ? l.find (' ', m + 1) : m);
+
+            if (l.size () < 3 || (l[0] != '0' && l[0] != '1') || l[1] != ' ' ||
+                s == string::npos || s + 1 == l.size ())
+              continue;
+
+            try
+            {
+              entry e {stoull (string (l, 2, m - 2)),
+                       stoull (string (l, m + 1, s - m - 1)),
+                       l[0] == '1'};
+
+              entries_.emplace (path (string (l, s + 1)), e);
+            }
+            catch (const std::exception&) // invalid_argument, out_of_range
+            {
+              continue;
+            }
+          }
+
+          is.close ();
+        }
+        catch (const io_error& e)
+        {
+          l4 ([&]{trace << "unable to read " << path_ << ": " << e;});
+          entries_.clear ();
+        }
+      }
+
+      void scan_cache::
+      save ()
+      {
+        tracer trace ("qt::moc::scan_cache::save");
+
+        mlock l (mutex_);
+
+        if (!dirty_ || dry_run_)
+          return;
+
+        dirty_ = false;
+
+        try
+        {
+          butl::try_mkdir_p (path_.directory ());
+
+          ofdstream os (path_);
+          os << cache_id << '\n';
+
+          for (auto i (entries_.begin ()); i != entries_.end (); )
+          {
+            const entry& e (i->second);
+
+            if (!butl::file_exists (i->first))
+            {
+              i = entries_.erase (i);
+              continue;
+            }
+
+            os << (e.macro ? '1' : '0') << ' ' << e.mtime << ' ' << e.size
+               << ' ' << i->first.string () << '\n';
+
+            ++i;
+          }
+
+          os.close ();
+        }
+        catch (const system_error& e)
+        {
+          // Note that io_error is derived from system_error.
+          //
+          l4 ([&]{trace << "unable to write to " << path_ << ": " << e;});
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/scope.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace moc
+    {
+      // Project-wide cache of the automoc{} input scan results.
+      //
+      // Each automoc{} group keeps the scan results of its inputs in its own
+      // depdb. However, if the same header is listed in several groups or is
+      // moved between groups (for example, during a refactoring), it would
+      // be scanned again from scratch. To avoid this, all the groups of a
+      // project also consult and update this cache, which is keyed by the
+      // input path and validated with its modification time and size.
+      //
+      // The cache is loaded lazily on the first lookup and saved (if
+      // changed) at the end of update into out_root/build/qt/moc/scan-cache
+      // (see save()). It is also saved when destroyed together with the
+      // build context, which covers the updates that don't go through the
+      // project's root directory (for example, `b update: sub/`). It is
+      // never saved in the dry run mode (--dry-run) and is removed on clean
+      // (see clean_sidebuilds()).
+      //
+      class LIBBUILD2_QT_SYMEXPORT scan_cache
+      {
+      public:
+        // Return the cache of the project, creating it if necessary. The
+        // cache is shared by all the modules of a project.
+        //
+        static shared_ptr<scan_cache>
+        open (const scope& rs);
+
+        scan_cache (path, bool dry_run);
+
+        ~scan_cache ();
+
+        // Return the cached scan result (true if the file contains moc
+        // macros) or nullopt if there is no entry for this file or it is
+        // out of date.
+        //
+        optional<bool>
+        find (const path&, timestamp mtime, uint64_t size);
+
+        void
+        insert (const path&, timestamp mtime, uint64_t size, bool macro);
+
+        // Save the cache if it has changed (and this is not a dry run),
+        // dropping the entries for the files that no longer exist. Failure
+        // to save is not an error since the cache is just an optimization.
+        //
+        void
+        save ();
+
+        // Return the cache file path for the project.
+        //
+        static path
+        file (const scope& rs);
+
+      private:
+        void
+        load ();
+
+        struct entry
+        {
+          uint64_t mtime; // Nanoseconds since epoch.
+          uint64_t size;
+          bool     macro;
+        };
+
+        const path       path_;
+        const bool       dry_run_;
+        mutex            mutex_;
+        bool             loaded_ = false;
+        bool             dirty_ = false;
+        map<path, entry> entries_;
+      };
+    }
+  }
+}
@@ -0,0 +1,59 @@
+#include <libbuild2/qt/moc/scanner.hxx>
+
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/cc/lexer.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace moc
+    {
+      bool
+      scan_moc_macros (const path& f, uint64_t* tokens)
+      {
+        using namespace build2::cc; // lexer, token, token_type
+
+        ifdstream is (ifdstream::badbit);
+        try
+        {
+          is.open (f);
+        }
+        catch (const io_error& e)
+        {
+          fail << "unable to open file " << f << ": " << e;
+        }
+
+        bool r (false); // True if a moc macro was found.
+
+        path_name pn (f);
+        lexer l (is, pn, false /* preprocessed */);
+
+        uint64_t n (0); // Number of tokens scanned.
+
+        for (token t (l.next ()); t.type != token_type::eos; t = l.next ())
+        {
+          ++n;
+
+          if (t.type == token_type::identifier)
+          {
+            if (t.value == "Q_OBJECT"    ||
+                t.value == "Q_GADGET"    ||
+                t.value == "Q_NAMESPACE" ||
+                t.value == "Q_NAMESPACE_EXPORT")
+            {
+              r = true;
+              break;
+            }
+          }
+        }
+
+        if (tokens != nullptr)
+          *tokens += n;
+
+        return r;
+      }
+    }
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace moc
+    {
+      // Scan a C++ header or source file for the presence of Qt meta-object
+      // macros (Q_OBJECT, Q_GADGET, Q_NAMESPACE, and Q_NAMESPACE_EXPORT),
+      // returning true if any were found. Stop scanning at the first macro.
+      // If tokens is not NULL, then add the number of tokens scanned to it.
+      //
+      // This is the automoc{} input scanner that is also used by the scanner
+      // benchmark (see bench/ in the package root).
+      //
+      LIBBUILD2_QT_SYMEXPORT bool
+      scan_moc_macros (const path&, uint64_t* tokens = nullptr);
+    }
+  }
+}
@@ -22,6 +22,27 @@ namespace build2
         target_type::flag::none
       };
 
+      // metatypes
+      //
+      // Note that there is no default extension since otherwise other JSON
+      // files (for example, the Q_PLUGIN_METADATA file or rcc resources)
+      // would be mapped to this target type when entered as dynamic
+      // dependencies. Instead, the rule uses .json as the default extension
+      // when deriving the target path.
+      //
+      const target_type metatypes::static_type
+      {
+        "metatypes",
+        &file::static_type,
+        &target_factory<metatypes>,
+        nullptr /* fixed_extension */,
+        &target_extension_var<nullptr>,
+        &target_pattern_var<nullptr>,
+        nullptr /* print */,
+        &file_search,
+        target_type::flag::none
+      };
+
       // automoc
       //
       group_view automoc::
@@ -34,7 +55,9 @@ namespace build2
         // only good for that operation.
         //
         // We also re-discover the members on each update and clean not to
-        // overcomplicate the already complicated automoc_rule::apply() logic.
+        // overcomplicate the already complicated automoc_rule::apply() logic
+        // (though on update it may decide to carry them over; see
+        // automoc::reuse_members()).
         //
         if (members_on != ctx.current_on)
         {
@@ -29,6 +29,24 @@ namespace build2
         static const target_type static_type;
       };
 
+      // A JSON file containing the meta-object descriptions (metatypes)
+      // collected from the moc outputs (cxx{moc_*}, moc{}, or automoc{}
+      // groups thereof) that are its prerequisites, the equivalent of moc
+      // --collect-json (e.g., for QML type registration).
+      //
+      class LIBBUILD2_QT_SYMEXPORT metatypes: public file
+      {
+      public:
+        metatypes (context& c, dir_path d, dir_path o, string n)
+            : file (c, move (d), move (o), move (n))
+        {
+          dynamic_type = &static_type;
+        }
+
+      public:
+        static const target_type static_type;
+      };
+
       // A see-through group which is dynamically populated with a cxx{moc_*}
       // and/or moc{} target members for each hxx{} or cxx{} prerequisite that
       // needs to be compiled by moc.
@@ -46,14 +64,36 @@ namespace build2
         action members_action; // Action on which members were resolved.
         size_t members_on = 0; // Operation number on which members were resolved.
 
+        // Input header and source files (sorted by path) from which the
+        // members were resolved on update (see reuse_members()).
+        //
+        vector<const target*> inputs;
+
+        // Library and ad hoc header prerequisites of the group. Rather than
+        // being copied into each member's prerequisites, these are shared by
+        // all the members and added by the moc compile rule. Collected anew
+        // by the automoc rule's apply() before the members are matched.
+        //
+        vector<prerequisite> extras;
+
         void
         reset_members (action a)
         {
           members.clear ();
+          inputs.clear ();
           members_action = a;
           members_on = ctx.current_on;
         }
 
+        // Carry over the members resolved on update during an earlier
+        // operation to the current operation.
+        //
+        void
+        reuse_members ()
+        {
+          members_on = ctx.current_on;
+        }
+
         automoc (context& c, dir_path d, dir_path o, string n)
             : target (c, move (d), move (o), move (n))
         {
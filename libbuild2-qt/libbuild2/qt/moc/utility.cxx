@@ -2,6 +2,8 @@
 
 #include <libbuild2/filesystem.hxx>
 
+#include <libbuild2/qt/moc/scan-cache.hxx>
+
 namespace build2
 {
   namespace qt
@@ -13,6 +15,39 @@ namespace build2
       const dir_path module_dir (dir_path (qt::module_dir) /= "moc");
       const dir_path module_build_dir (dir_path (module_dir) /= "build");
 
+      // Predefs caches of the build contexts (see predefs_cache::open()).
+      //
+      static mutex predefs_caches_mutex;
+      static map<const context*, std::weak_ptr<predefs_cache>> predefs_caches;
+
+      shared_ptr<predefs_cache> predefs_cache::
+      open (context& ctx)
+      {
+        mlock l (predefs_caches_mutex);
+
+        // Remove the expired entries of the contexts that have been destroyed
+        // (whose addresses could otherwise be reused by new contexts).
+        //
+        for (auto i (predefs_caches.begin ()); i != predefs_caches.end (); )
+        {
+          if (i->second.expired ())
+            i = predefs_caches.erase (i);
+          else
+            ++i;
+        }
+
+        std::weak_ptr<predefs_cache>& w (predefs_caches[&ctx]);
+
+        shared_ptr<predefs_cache> r (w.lock ());
+        if (r == nullptr)
+        {
+          r = make_shared<predefs_cache> ();
+          w = r;
+        }
+
+        return r;
+      }
+
       target_state
       clean_sidebuilds (action, const scope& rs, const build2::dir&)
       {
@@ -22,37 +57,42 @@ namespace build2
 
         const dir_path& out_root (rs.out_path ());
 
+        // Remove the automoc{} scan cache (see scan_cache for details).
+        //
+        bool r (rmfile (ctx, scan_cache::file (rs), 3) ==
+                rmfile_status::success);
+
         dir_path d (out_root / rs.root_extra->build_dir / module_build_dir);
 
-        if (exists (d))
+        if (exists (d) && rmdir_r (ctx, d))
+          r = true;
+
+        if (r)
         {
-          if (rmdir_r (ctx, d))
+          // Clean up moc/ if it became empty.
+          //
+          d = out_root / rs.root_extra->build_dir / module_dir;
+          if (empty (d))
           {
-            // Clean up moc/ if it became empty.
+            rmdir (ctx, d, 2);
+
+            // Clean up qt/ if it became empty.
             //
-            d = out_root / rs.root_extra->build_dir / module_dir;
+            d = out_root / rs.root_extra->build_dir / qt::module_dir;
             if (empty (d))
             {
               rmdir (ctx, d, 2);
 
-              // Clean up qt/ if it became empty.
+              // And build/ if it also became empty (e.g., in case of a
+              // build with a transient configuration).
               //
-              d = out_root / rs.root_extra->build_dir / qt::module_dir;
+              d = out_root / rs.root_extra->build_dir;
               if (empty (d))
-              {
                 rmdir (ctx, d, 2);
-
-                // And build/ if it also became empty (e.g., in case of a
-                // build with a transient configuration).
-                //
-                d = out_root / rs.root_extra->build_dir;
-                if (empty (d))
-                  rmdir (ctx, d, 2);
-              }
             }
-
-            return target_state::changed;
           }
+
+          return target_state::changed;
         }
 
         return target_state::unchanged;
@@ -32,7 +32,8 @@ namespace build2
       bool
       pass_moc_options (const T&, const char* option_class);
 
-      // Scope operation callback that cleans up moc module sidebuilds.
+      // Scope operation callback that cleans up moc module sidebuilds (as
+      // well as the automoc{} scan cache).
       //
       // For now the only known case where build/qt/moc/ does not get removed
       // by the standard fsdir{} chain (i.e., when this callback is not
@@ -43,6 +44,31 @@ namespace build2
       //
       target_state
       clean_sidebuilds (action, const scope& rs, const build2::dir&);
+
+      // Automatic predefs headers of the projects of a build context.
+      //
+      // Projects that use the same C++ compiler with the same relevant
+      // options end up with identical predefs headers so there is no reason
+      // to extract them more than once. Instead, a subproject reuses the
+      // header of the outermost amalgamation with the same compiler and
+      // options (see the auto_predefs() lambda in compile_rule::apply() for
+      // details).
+      //
+      struct predefs_cache
+      {
+        mutex mutex_;
+
+        // Map of the project root scopes to their header targets.
+        //
+        map<const scope*, const target*> headers;
+
+        // Return the cache of the context, creating it if necessary. The
+        // cache is destroyed once the last reference (normally held by the
+        // module data) is released.
+        //
+        static shared_ptr<predefs_cache>
+        open (context&);
+      };
     }
   }
 }
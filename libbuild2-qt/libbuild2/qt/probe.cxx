@@ -0,0 +1,165 @@
+#include <libbuild2/qt/probe.hxx>
+
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    optional<probe_result>
+    probe_exe (context& ctx,
+               const string& name,
+               uint64_t qt_ver,
+               const path& cache,
+               bool use_cache)
+    {
+      tracer trace ("qt::probe_exe");
+
+      // Distributions that install several Qt versions side by side often
+      // add the version suffix to the compiler names (e.g., moc-qt5), so try
+      // such a name first.
+      //
+      process_path pp;
+      for (const string& n: {name + "-qt" + to_string (qt_ver), name})
+      {
+        pp = process::try_path_search (path (n), true /* init */);
+
+        if (!pp.empty ())
+          break;
+      }
+
+      if (pp.empty ())
+        return nullopt;
+
+      path p (pp.effect_string ());
+
+      // The executable's modification time and size which, together with
+      // its path, are used to validate the cached probe results.
+      //
+      string mt, sz;
+      {
+        timestamp t (file_mtime (p));
+
+        if (t == timestamp_nonexistent)
+          return nullopt;
+
+        mt = to_string (t.time_since_epoch ().count ());
+
+        auto pe (butl::path_entry (p, true /* follow_symlinks */));
+        sz = to_string (pe.second.size);
+      }
+
+      // Try to use the cached results. The cache file format is as follows:
+      //
+      // <path>
+      // <mtime>
+      // <size>
+      // <version>
+      // <checksum>
+      //
+      if (use_cache && exists (cache))
+      {
+        try
+        {
+          ifdstream is (cache);
+
+          strings ls;
+          for (string l; ls.size () != 5 && !eof (getline (is, l)); )
+            ls.push_back (move (l));
+
+          is.close ();
+
+          if (ls.size () == 5                                  &&
+              ls[0] == p.string () && ls[1] == mt && ls[2] == sz &&
+              !ls[3].empty () && !ls[4].empty ())
+          {
+            l5 ([&]{trace << "using cached probe of " << p << " from "
+                          << cache;});
+
+            return probe_result {move (pp), move (ls[3]), move (ls[4])};
+          }
+        }
+        catch (const io_error& e)
+        {
+          // The cache is just an optimization so re-probe.
+          //
+          l4 ([&]{trace << "unable to read " << cache << ": " << e;});
+        }
+      }
+
+      // Extract the version from the first line of the --version output,
+      // which has the `<name> <version>` form (e.g., `moc 6.5.3`).
+      //
+      string ver;
+      {
+        const char* args[] = {pp.recall_string (), "--version", nullptr};
+
+        string l (run<string> (ctx,
+                               3 /* verbosity */,
+                               pp,
+                               args,
+                               3 /* finish_verbosity */,
+                               [] (string& l, bool) {return move (l);}));
+
+        size_t i (l.rfind (' '));
+        if (i != string::npos)
+          ver.assign (l, i + 1, string::npos);
+
+        try
+        {
+          standard_version v (ver);
+
+          if (v.major () != qt_ver)
+            l4 ([&]{trace << p << " is Qt " << v.major () << " " << name
+                          << ", expected Qt " << qt_ver;});
+        }
+        catch (const invalid_argument&)
+        {
+          fail << "unable to extract version from " << p << " --version "
+               << "output '" << l << "'";
+        }
+      }
+
+      string cs;
+      try
+      {
+        ifdstream is (p, ifdstream::binary);
+
+        sha256 h;
+        h.append (is);
+        cs = h.string ();
+
+        is.close ();
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to read " << p << ": " << e;
+      }
+
+      // Save the results to the cache.
+      //
+      try
+      {
+        butl::try_mkdir_p (cache.directory ());
+
+        ofdstream os (cache);
+        os << p.string () << '\n'
+           << mt << '\n'
+           << sz << '\n'
+           << ver << '\n'
+           << cs << '\n';
+        os.close ();
+      }
+      catch (const system_error& e)
+      {
+        // Note that io_error is derived from system_error. The cache is
+        // just an optimization so we only trace the failure.
+        //
+        l4 ([&]{trace << "unable to write to " << cache << ": " << e;});
+      }
+
+      return probe_result {move (pp), move (ver), move (cs)};
+    }
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/context.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Information about a system-installed Qt compiler (see probe_exe()).
+    //
+    struct probe_result
+    {
+      process_path path;
+      string       version;  // Standard version (e.g., 6.5.3).
+      string       checksum; // SHA256 checksum of the executable.
+    };
+
+    // Search for a system-installed upstream Qt compiler (`moc`, `rcc`, or
+    // `uic`) of the specified Qt (major) version in PATH and extract the
+    // information that would normally come from its build2 metadata.
+    //
+    // The version is extracted by running the compiler with --version and
+    // the checksum is calculated from the executable's contents. Since doing
+    // this on every build system invocation for every project would be
+    // wasteful, the results are cached in the specified file and are only
+    // recalculated if the executable's path, modification time, or size
+    // change, or if the cache is not to be used (for example, on configure).
+    //
+    // Return nullopt if no compiler was found. Note that the compiler found
+    // may be of a different Qt version (the unsuffixed name is tried if
+    // there is none with the version suffix) in which case the caller is
+    // expected to diagnose the mismatch (see probe_result::version).
+    //
+    LIBBUILD2_QT_SYMEXPORT optional<probe_result>
+    probe_exe (context&,
+               const string& name,   // Compiler name (`moc`/`rcc`/`uic`).
+               uint64_t qt_ver,      // Qt version (major).
+               const path& cache,    // Probe cache file.
+               bool use_cache);
+  }
+}
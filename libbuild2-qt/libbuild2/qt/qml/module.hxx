@@ -0,0 +1,30 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/module.hxx>
+
+#include <libbuild2/qt/qml/rule.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace qml
+    {
+      class module: public build2::module,
+                    public virtual data,
+                    public compile_rule
+      {
+      public:
+        explicit module (data&& d): data (move (d)), compile_rule (move (d)) {}
+
+        // Printer of the rule statistics (see register_statistics() in
+        // init.cxx). Note: must be destroyed before the rules.
+        //
+        shared_ptr<void> statistics;
+      };
+    }
+  }
+}
@@ -0,0 +1,457 @@
+#include <libbuild2/qt/qml/rule.hxx>
+
+#include <libbuild2/depdb.hxx>
+#include <libbuild2/algorithm.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/qt/run.hxx>
+
+#include <libbuild2/qt/qml/target.hxx>
+#include <libbuild2/qt/rcc/target.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace qml
+    {
+      using rcc::qrc;
+
+      static const char*
+      mode_name (compile_rule::mode m)
+      {
+        switch (m)
+        {
+        case compile_rule::mode::cachegen: return "cachegen";
+        case compile_rule::mode::loader:   return "loader";
+        case compile_rule::mode::qmltc:    return "qmltc";
+        }
+
+        return nullptr;
+      }
+
+      // Return the first ad hoc hxx{} member of the target or NULL if there
+      // is none.
+      //
+      static const file*
+      find_header (const target& t)
+      {
+        for (const target* m (t.adhoc_member);
+             m != nullptr;
+             m = m->adhoc_member)
+        {
+          if (const file* h = m->is_a<compile_rule::hxx> ())
+            return h;
+        }
+
+        return nullptr;
+      }
+
+      bool compile_rule::
+      match (action a,
+             target& t,
+             const string& hint,
+             match_extra& me) const
+      {
+        tracer trace ("qt::qml::compile_rule::match");
+
+        bool src (false); // Have qml{} or js{} prerequisite.
+        bool doc (false); // Have qml{} prerequisite.
+        bool res (false); // Have qrc{} prerequisite.
+
+        for (prerequisite_member p: prerequisite_members (a, t))
+        {
+          if (include (a, t, p) != include_type::normal) // Excluded/ad hoc.
+            continue;
+
+          if (p.is_a<qml> ())
+            src = doc = true;
+          else if (p.is_a<js> ())
+            src = true;
+          else if (p.is_a<qrc> ())
+            res = true;
+        }
+
+        // Note that the mode is passed to apply() via match_extra.
+        //
+        if (src)
+        {
+          if (find_header (t) == nullptr)
+          {
+            me.data (mode::cachegen);
+            return true;
+          }
+
+          if (doc)
+          {
+            me.data (mode::qmltc);
+            return true;
+          }
+
+          l4 ([&]{trace << "no QML document for target " << t;});
+          return false;
+        }
+
+        // The rcc rule matches a cxx{} target with qrc{} prerequisites as
+        // well so we require the qt.qml.loader rule hint to generate the
+        // loader (see the rule registration in init.cxx).
+        //
+        if (res && hint == "qt.qml.loader")
+        {
+          me.data (mode::loader);
+          return true;
+        }
+
+        l4 ([&]{trace << "no QML document or JavaScript file for target "
+                      << t;});
+        return false;
+      }
+
+      recipe compile_rule::
+      apply (action a, target& xt, match_extra& me) const
+      {
+        file& t (xt.as<file> ());
+        mode m (me.data<mode> ());
+
+        t.derive_path ();
+
+        // Derive the header path (the ad hoc group member) for qmltc.
+        //
+        if (m == mode::qmltc)
+          const_cast<file*> (find_header (t))->derive_path ();
+
+        // Inject dependency on the output directory.
+        //
+        inject_fsdir (a, t);
+
+        // Match prerequisites.
+        //
+        match_prerequisite_members (a, t);
+
+        // For update inject dependency on the compiler target (importing it
+        // first if the import was deferred).
+        //
+        if (a == perform_update_id && lazy != nullptr)
+          (*lazy) (t.ctx);
+
+        if (a == perform_update_id && version != 0)
+        {
+          if (m == mode::qmltc)
+          {
+            if (tc_ctgt == nullptr)
+              fail << "unable to compile " << t << " with qmltc" <<
+                info << "qmltc is not enabled" <<
+                info << "set config.qt.qml.qmltc=true to enable";
+
+            inject (a, t, *tc_ctgt);
+          }
+          else if (ctgt != nullptr)
+            inject (a, t, *ctgt);
+        }
+
+        switch (a)
+        {
+        case perform_update_id: return [this, m] (action a, const target& t)
+          {
+            return perform_update (a, t, m);
+          };
+        case perform_clean_id:  return [] (action a, const target& t)
+          {
+            // Note that this also cleans the ad hoc header of qmltc.
+            //
+            return perform_clean_extra (a, t.as<file> (), {".d"});
+          };
+        default:                return noop_recipe; // Configure/dist update.
+        }
+      }
+
+      target_state compile_rule::
+      perform_update (action a, const target& xt, mode m) const
+      {
+        tracer trace ("qt::qml::compile_rule::perform_update");
+
+        if (ctgt == nullptr)
+          fail << "attempt to " << diag_do (a, xt)
+               << " during load-only testing (qt.version=0)";
+
+        context& ctx (xt.ctx);
+
+        const file& t (xt.as<file> ());
+        const path& tp (t.path ());
+
+        bool tc (m == mode::qmltc);
+
+        const exe&    c (tc ? *tc_ctgt : *ctgt);
+        const string& cs (tc ? *tc_csum : *csum);
+        const char*   ov (tc ? "qt.qml.qmltc_options" : "qt.qml.options");
+        const char*   cn (tc ? "qmltc" : "qmlcachegen");
+
+        // Update prerequisites and determine if any render us out-of-date.
+        //
+        timestamp mt (t.load_mtime ());
+        rule_counters::increment (counters.stats);
+        optional<target_state> ps (execute_prerequisites (a, t, mt));
+
+        bool update (!ps);
+        target_state ts (update ? target_state::changed : *ps);
+
+        // Collect the input files: the first qml{} or js{} prerequisite or
+        // all the qrc{} prerequisites for the loader.
+        //
+        vector<const file*> ins;
+
+        for (const prerequisite_target& p: t.prerequisite_targets[a])
+        {
+          const target* pt (p.target);
+
+          if (pt == nullptr)
+            continue;
+
+          if (m == mode::loader)
+          {
+            if (pt->is_a<qrc> ())
+              ins.push_back (&pt->as<file> ());
+          }
+          else if (pt->is_a<qml> () || (!tc && pt->is_a<js> ()))
+          {
+            ins.push_back (&pt->as<file> ());
+            break;
+          }
+        }
+
+        assert (!ins.empty ());
+
+        const file& s (*ins.front ());
+
+        // Determine the resource path of the input (under which the compiled
+        // code is looked up at runtime) or the resource name of the loader.
+        //
+        string rn;
+
+        if (m == mode::loader)
+        {
+          if (const string* v = cast_null<string> (t["qt.qml.resource_name"]))
+            rn = *v;
+          else
+          {
+            rn = "qmlcache_" + t.name;
+
+            for (char& ch: rn)
+              if (!alnum (ch))
+                ch = '_';
+          }
+        }
+        else
+        {
+          if (const string* v = cast_null<string> (t["qt.qml.resource_path"]))
+            rn = *v;
+          else
+          {
+            if (const string* v =
+                cast_null<string> (t["qt.qml.resource_prefix"]))
+              rn = *v;
+
+            if (rn.empty () || rn.back () != '/')
+              rn += '/';
+
+            // Use the input path relative to the base scope's src or, if
+            // generated, out directory so that the resource paths of files
+            // with the same name in different subdirectories don't clash.
+            //
+            const scope& bs (t.base_scope ());
+            const path& sp (s.path ());
+
+            rn += (sp.sub (bs.src_path ()) ? sp.leaf (bs.src_path ()) :
+                   sp.sub (bs.out_path ()) ? sp.leaf (bs.out_path ()) :
+                   sp.leaf ()).posix_string ();
+          }
+
+          if (rn.empty () || rn.front () != '/')
+            rn.insert (0, 1, '/');
+        }
+
+        // We use depdb to track changes to the input file names, options,
+        // compiler, etc.
+        //
+        optional<rebuild_cause> cause;
+
+        depdb dd (tp + ".d");
+        {
+          // First should come the rule name/version.
+          //
+          if (dd.expect ("qt.qml.compile 1") != nullptr)
+          {
+            l4 ([&]{trace << "rule mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::rule);
+          }
+          counters.depdb_line (dd);
+
+          // Then the compiler checksum.
+          //
+          if (dd.expect (cs) != nullptr)
+          {
+            l4 ([&]{trace << "compiler mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::compiler);
+          }
+          counters.depdb_line (dd);
+
+          // Then the options checksum (including the mode and the resource
+          // path/name).
+          //
+          {
+            xxh64 cs;
+            append_options (cs, t, ov);
+            append_option (cs, mode_name (m));
+            append_option (cs, rn.c_str ());
+
+            if (dd.expect (cs.string ()) != nullptr)
+            {
+              l4 ([&]{trace << "options mismatch forcing update of " << t;});
+              update_cause (cause, rebuild_reason::options);
+            }
+            counters.depdb_line (dd);
+          }
+
+          // Finally the input files.
+          //
+          for (const file* f: ins)
+          {
+            if (dd.expect (f->path ()) != nullptr)
+            {
+              l4 ([&]{trace << "input file mismatch forcing update of "
+                            << t;});
+              update_cause (cause,
+                            rebuild_reason::input, f->path ().string ());
+            }
+            counters.depdb_line (dd);
+          }
+        }
+
+        // Update if depdb mismatch.
+        //
+        if (dd.writing () || dd.mtime > mt)
+          update = true;
+
+        // Note that execute_prerequisites() doesn't tell us which
+        // prerequisite is newer.
+        //
+        if (update)
+        {
+          using r = rebuild_reason;
+
+          update_cause (cause,
+                        (dd.writing ()               ? r::depdb      :
+                         mt == timestamp_nonexistent ? r::output     :
+                         !ps                         ? r::dependency :
+                         r::outdated));
+        }
+
+        dd.close ();
+
+        if (!update)
+          return ts;
+
+        if (stats && cause)
+          rebuilds.record (t, *cause);
+
+        // Translate paths to relative (to working directory). This results in
+        // easier to read diagnostics.
+        //
+        path relo (relative (tp));
+        path relh;
+        paths rels;
+
+        for (const file* f: ins)
+          rels.push_back (relative (f->path ()));
+
+        const process_path& pp (c.process_path ());
+        cstrings args {pp.recall_string ()};
+
+        append_options (args, t, ov);
+
+        switch (m)
+        {
+        case mode::cachegen:
+          {
+            args.push_back ("--resource-path");
+            args.push_back (rn.c_str ());
+            args.push_back ("-o");
+            args.push_back (relo.string ().c_str ());
+            break;
+          }
+        case mode::loader:
+          {
+            args.push_back ("--resource-name");
+            args.push_back (rn.c_str ());
+            args.push_back ("-o");
+            args.push_back (relo.string ().c_str ());
+            break;
+          }
+        case mode::qmltc:
+          {
+            relh = relative (find_header (t)->path ());
+
+            args.push_back ("--resource-path");
+            args.push_back (rn.c_str ());
+            args.push_back ("--impl");
+            args.push_back (relo.string ().c_str ());
+            args.push_back ("--header");
+            args.push_back (relh.string ().c_str ());
+            break;
+          }
+        }
+
+        for (const path& p: rels)
+          args.push_back (p.string ().c_str ());
+
+        args.push_back (nullptr);
+
+        if (verb >= 2)
+          print_process (args);
+        else if (verb)
+          print_diag (cn, s, t);
+
+        if (!ctx.dry_run)
+        {
+          event_trace::span es (etrace.get ());
+          timestamp ts (timeline != nullptr
+                        ? system_clock::now ()
+                        : timestamp_unknown);
+
+          run_tool (ctx, pp, args, processes.get ());
+
+          if (timeline != nullptr)
+            timeline->record (t, cn, ts, system_clock::now ());
+
+          rule_counters::increment (counters.processes);
+          rule_counters::increment (counters.stats);
+          rule_counters::increment (counters.bytes,
+                                    event_trace::file_size (tp));
+
+          if (es)
+          {
+            event_trace::arguments ea;
+            ea ("input", s.path ().string ())
+               ("output", tp.string ())
+               ("mode", mode_name (m))
+               ("argc", args.size () - 1)
+               ("input_size", event_trace::file_size (s.path ()))
+               ("output_size", event_trace::file_size (tp));
+
+            if (cause)
+              ea ("reason", reason_name (cause->reason));
+
+            es.complete ("qt.qml",
+                         string (cn) + ' ' + s.path ().leaf ().string (),
+                         move (ea));
+          }
+
+          dd.check_mtime (tp);
+        }
+
+        t.mtime (system_clock::now ());
+        return target_state::changed;
+      }
+    }
+  }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/rule.hxx>
+
+#include <libbuild2/cxx/target.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+#include <libbuild2/qt/budget.hxx>
+#include <libbuild2/qt/counters.hxx>
+#include <libbuild2/qt/lazy-import.hxx>
+#include <libbuild2/qt/event-trace.hxx>
+#include <libbuild2/qt/rebuild-log.hxx>
+#include <libbuild2/qt/timeline.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace qml
+    {
+      // Cached data shared between rules and the module.
+      //
+      struct data
+      {
+        const uint64_t version; // qt.version
+        const exe*     ctgt;    // Qmlcachegen target (NULL if load-only).
+        const string*  csum;    // Qmlcachegen checksum.
+        const exe*     tc_ctgt; // Qmltc target (NULL if not enabled).
+        const string*  tc_csum; // Qmltc checksum.
+
+        shared_ptr<event_trace> etrace; // Event trace (NULL if disabled).
+        shared_ptr<generation_timeline> timeline; // NULL if disabled.
+        bool stats = false;             // Print rule counters.
+
+        // Limit on the number of Qt compiler processes in flight or NULL if
+        // unlimited (see config.qt.max_processes).
+        //
+        shared_ptr<budget> processes;
+
+        // Deferred compiler import or NULL if the compilers were imported
+        // when the module was loaded (see config.qt.lazy_import). If not
+        // NULL, then the compiler information above is only valid once it
+        // has been called.
+        //
+        shared_ptr<lazy_import> lazy;
+
+        // Keeps the context-wide cache of the imported compilers alive (see
+        // import_exe() in init.cxx for details).
+        //
+        shared_ptr<void> import_cache;
+      };
+
+      // Compile QML documents and JavaScript files ahead of time. Depending
+      // on the prerequisites and the target, one of the following is done:
+      //
+      // cachegen -- Compile the first qml{} or js{} prerequisite into the
+      //             cxx{} target with qmlcachegen (QML byte code and,
+      //             where possible, C++ code for the bindings and
+      //             functions).
+      //
+      // loader   -- Generate the loader (cxx{}) that registers the compiled
+      //             QML documents and JavaScript files listed in the qrc{}
+      //             prerequisites with the QML engine (qmlcachegen
+      //             --resource-name). Only matched with the qt.qml.loader
+      //             rule hint since the rcc rule would match otherwise.
+      //
+      // qmltc    -- Compile the first qml{} prerequisite into a C++ class,
+      //             the cxx{} target with the ad hoc hxx{} member, with
+      //             qmltc (if enabled with config.qt.qml.qmltc).
+      //
+      class LIBBUILD2_QT_SYMEXPORT compile_rule: public rule,
+                                                 private virtual data
+      {
+      public:
+        explicit
+        compile_rule (data&& d): data (move (d)) {}
+
+        virtual bool
+        match (action, target&, const string&, match_extra&) const override;
+
+        virtual recipe
+        apply (action, target&, match_extra&) const override;
+
+        enum class mode {cachegen, loader, qmltc};
+
+        target_state
+        perform_update (action, const target&, mode) const;
+
+        mutable rule_counters counters;
+        mutable rebuild_log   rebuilds;
+
+        using cxx = build2::cxx::cxx;
+        using hxx = build2::cxx::hxx;
+      };
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#include <libbuild2/qt/qml/target.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace qml
+    {
+      // qml
+      //
+      extern const char qml_ext[] = "qml";
+      const target_type qml::static_type
+      {
+        "qml",
+        &file::static_type,
+        &target_factory<qml>,
+        &target_extension_fix<qml_ext>,
+        nullptr, /* default_extension */
+        &target_pattern_fix<qml_ext>,
+        nullptr /* print */,
+        &file_search,
+        target_type::flag::none
+      };
+
+      // js
+      //
+      extern const char js_ext[] = "js";
+      const target_type js::static_type
+      {
+        "js",
+        &file::static_type,
+        &target_factory<js>,
+        nullptr /* fixed_extension */,
+        &target_extension_var<js_ext>,
+        &target_pattern_var<js_ext>,
+        nullptr /* print */,
+        &file_search,
+        target_type::flag::none
+      };
+    }
+  }
+}
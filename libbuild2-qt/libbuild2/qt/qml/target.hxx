@@ -0,0 +1,48 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/target.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    namespace qml
+    {
+      // QML document.
+      //
+      class LIBBUILD2_QT_SYMEXPORT qml: public file
+      {
+      public:
+        qml (context& c, dir_path d, dir_path o, string n)
+            : file (c, move (d), move (o), move (n))
+        {
+          dynamic_type = &static_type;
+        }
+
+      public:
+        static const target_type static_type;
+      };
+
+      // JavaScript file imported by QML documents (the default extension is
+      // .js but ECMAScript modules, .mjs, are supported as well).
+      //
+      class LIBBUILD2_QT_SYMEXPORT js: public file
+      {
+      public:
+        js (context& c, dir_path d, dir_path o, string n)
+            : file (c, move (d), move (o), move (n))
+        {
+          dynamic_type = &static_type;
+        }
+
+      public:
+        static const target_type static_type;
+      };
+    }
+  }
+}
@@ -9,6 +9,8 @@
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/make-parser.hxx>
 
+#include <libbuild2/qt/run.hxx>
+
 #include <libbuild2/qt/rcc/target.hxx>
 
 // @@ TODO: support multiple qrc{} inputs if/when have a use-case. Note that
@@ -39,8 +41,15 @@ namespace build2
 
         const size_t pts_n; // Number of static prerequisites.
 
+        // Total size of the input and resource files as of the last update
+        // (see read_bytes()). Absent if unknown.
+        //
+        optional<uint64_t> bytes;
+
         timestamp mt;
 
+        optional<rebuild_cause> cause; // Set if the target needs updating.
+
         const compile_rule& rule;
 
         target_state
@@ -50,6 +59,66 @@ namespace build2
         }
       };
 
+      // Return the estimated amount of memory (in bytes) required by rcc to
+      // compile the input and resource files of the specified total size.
+      //
+      // Rcc keeps all the resources in memory, both as read and compressed,
+      // and builds the entire output (which is several times larger than
+      // the input since the data is written as C++ array initializers) in
+      // memory before writing it. This estimate is intentionally on the
+      // generous side.
+      //
+      static inline uint64_t
+      memory_estimate (uint64_t bytes)
+      {
+        return 64 * 1024 * 1024 + 8 * bytes;
+      }
+
+      // Return the total size of the input and resource files recorded in
+      // the depdb (the line that follows the blank line terminating the
+      // resource paths) or nullopt if it does not exist or is invalid.
+      //
+      // Note that we read it directly rather than with depdb since it is
+      // needed when the target is out of date, in which case the depdb
+      // verification never gets to it.
+      //
+      static optional<uint64_t>
+      read_bytes (const path& f)
+      {
+        try
+        {
+          if (!exists (f))
+            return nullopt;
+
+          ifdstream is (f);
+
+          bool blank (false);
+          for (string l; !eof (getline (is, l)); )
+          {
+            if (blank)
+            {
+              try
+              {
+                return static_cast<uint64_t> (stoull (l));
+              }
+              catch (const std::exception&) // invalid_argument, out_of_range
+              {
+                return nullopt;
+              }
+            }
+
+            blank = l.empty ();
+          }
+        }
+        catch (const io_error&)
+        {
+          // Since the size is only an estimate, treat failure to read it as
+          // unknown.
+        }
+
+        return nullopt;
+      }
+
       bool compile_rule::
       match (action a, target& t) const
       {
@@ -85,8 +154,12 @@ namespace build2
         //
         const fsdir* dir (inject_fsdir (a, t));
 
-        // For update inject dependency on the RCC compiler target.
+        // For update inject dependency on the RCC compiler target (importing
+        // it first if the import was deferred).
         //
+        if (a == perform_update_id && lazy != nullptr)
+          (*lazy) (t.ctx);
+
         if (a == perform_update_id && ctgt != nullptr)
           inject (a, t, *ctgt);
 
@@ -98,7 +171,7 @@ namespace build2
         {
           return [] (action a, const target& t)
           {
-            return perform_clean_extra (a, t.as<file> (), {".d", ".t"});
+            return perform_clean_extra (a, t.as<file> (), {".d", ".t", ".f"});
           };
         }
         else if (a != perform_update_id)
@@ -135,17 +208,44 @@ namespace build2
         // for the first time (ever, or after a new generated resource was
         // added to the build) and thus rcc would keep failing.
         //
+        // The resource paths are terminated with a blank line which is
+        // followed by the total size of the input and resource files as of
+        // the last update. It is used to estimate the memory required by
+        // the next rcc run (see config.qt.rcc.max_memory).
+        //
+        optional<rebuild_cause> cause; // Moved to match_data below.
+
+        // If we have the memory budget, then read the total size before the
+        // depdb verification below which stops (and truncates the depdb) as
+        // soon as we know we need to update, which is exactly when we need
+        // the size.
+        //
+        optional<uint64_t> bytes;
+        if (memory != nullptr)
+        {
+          bytes = read_bytes (tp + ".d");
+          rule_counters::increment (counters.depdb_reads);
+        }
+
         depdb dd (tp + ".d");
         {
           // First should come the rule name/version.
           //
-          if (dd.expect ("qt.rcc.compile 1") != nullptr)
+          if (dd.expect ("qt.rcc.compile 2") != nullptr)
+          {
             l4 ([&]{trace << "rule mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::rule);
+          }
+          counters.depdb_line (dd);
 
           // Then the compiler checksum.
           //
-          if (dd.expect (csum) != nullptr)
+          if (dd.expect (*csum) != nullptr)
+          {
             l4 ([&]{trace << "compiler mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::compiler);
+          }
+          counters.depdb_line (dd);
 
           // Then the options checksum.
           //
@@ -154,13 +254,21 @@ namespace build2
             append_options (cs, t, "qt.rcc.options");
 
             if (dd.expect (cs.string ()) != nullptr)
+            {
               l4 ([&]{trace << "options mismatch forcing update of " << t;});
+              update_cause (cause, rebuild_reason::options);
+            }
+            counters.depdb_line (dd);
           }
 
           // Finally the .qrc input file.
           //
           if (dd.expect (s->path ()) != nullptr)
+          {
             l4 ([&]{trace << "input file mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::input, s->path ().string ());
+          }
+          counters.depdb_line (dd);
         }
 
         // Determine if we need to do an update based on the above checks.
@@ -172,13 +280,21 @@ namespace build2
         {
           u = true;
           mt = timestamp_nonexistent;
+          update_cause (cause, rebuild_reason::depdb);
         }
         else
         {
           if ((mt = t.mtime ()) == timestamp_unknown)
+          {
             t.mtime (mt = mtime (tp));
+            rule_counters::increment (counters.stats);
+          }
 
-          u = dd.mtime > mt;
+          if ((u = dd.mtime > mt))
+            update_cause (cause,
+                          (mt == timestamp_nonexistent
+                           ? rebuild_reason::output
+                           : rebuild_reason::outdated));
         }
 
         // Update the static prerequisites (including the qrc{} input and,
@@ -193,14 +309,35 @@ namespace build2
         // for the sake of simplicity and consistency with the general
         // approach of using the dyndep_rule mechanisms.
         //
+        // If fingerprints are enabled and the qrc{} input is newer than the
+        // output, then we only check its fingerprint once we know nothing
+        // else has changed (see below).
+        //
+        bool fp_check (false);
         {
           auto& pts (t.prerequisite_targets[a]);
 
           for (prerequisite_target& p: pts)
-            u = update (trace, a, *p.target, u ? timestamp_unknown : mt) || u;
+          {
+            if (update (trace, a, *p.target, u ? timestamp_unknown : mt) && !u)
+            {
+              if (fingerprint && p.target == s)
+              {
+                fp_check = true;
+                continue;
+              }
+
+              u = true;
+              update_cause (cause,
+                            rebuild_reason::dependency,
+                            cause_detail (*p.target));
+            }
+          }
         }
 
         match_data md (*this, t.prerequisite_targets[a].size ());
+        md.cause = move (cause);
+        md.bytes = bytes;
 
         // Verify the resource paths in the depdb unless we're already
         // updating (in which case they will be overwritten in
@@ -214,8 +351,26 @@ namespace build2
           // Return true if the resource has changed and nullopt if it does
           // not exist.
           //
-          auto add = [&trace, a, &bs, &t, mt] (path fp) -> optional<bool>
+          auto add = [this, &trace, a, &bs, &t, mt] (path fp)
+            -> optional<bool>
           {
+            // If the change journal says the file has not changed since
+            // the output was produced, then skip entering and matching its
+            // target (see config.qt.change_journal for details).
+            //
+            if (journal != nullptr)
+            {
+              optional<bool> c (journal->changed (t.ctx, fp, mt));
+
+              if (c && !*c)
+              {
+                rule_counters::increment (counters.journal);
+                return false;
+              }
+            }
+
+            rule_counters::increment (counters.lookups);
+
             if (const build2::file* ft = enter_file (
                   trace, "resource file",
                   a, bs, t,
@@ -247,22 +402,42 @@ namespace build2
 
           // Read the resource paths from the depdb.
           //
+          // Note that the total size that follows the blank line is only
+          // skipped here (it is read back by read_bytes()) but we still have
+          // to read it since closing the database in the read mode truncates
+          // any unread lines, which would make it newer than the output.
+          //
           while (!u)
           {
             // We should always end with a blank line.
             //
             string* l (dd.read ());
+            rule_counters::increment (counters.depdb_reads);
 
             // If the line is invalid, run rcc.
             //
             if (l == nullptr)
             {
               u = true;
+              update_cause (md.cause, rebuild_reason::invalid);
               break;
             }
 
             if (l->empty ()) // Done, nothing changed.
+            {
+              // Skip the total size line (see above). If it is missing, then
+              // the database is invalid.
+              //
+              rule_counters::increment (counters.depdb_reads);
+
+              if (dd.read () == nullptr)
+              {
+                u = true;
+                update_cause (md.cause, rebuild_reason::invalid);
+              }
+
               break;
+            }
 
             if (optional<bool> r = add (path (*l)))
             {
@@ -273,19 +448,49 @@ namespace build2
               md.skip_count++;
 
               if (*r)
+              {
                 u = true;
+                update_cause (md.cause, rebuild_reason::dependency, *l);
+              }
             }
             else
             {
               // Resource does not exist. Invalidate this line and trigger
               // update.
               //
+              update_cause (md.cause, rebuild_reason::missing, *l);
+
               dd.write ();
+              rule_counters::increment (counters.depdb_writes);
               u = true;
             }
           }
         }
 
+        // If only the qrc{} input has changed, then check its fingerprint
+        // and only update if it has changed as well (see the moc rule for
+        // details).
+        //
+        if (!u && fp_check)
+        {
+          if (fingerprint_unchanged (tp + ".f",
+                                     s->path (), s->load_mtime (),
+                                     fingerprint_kind::xml,
+                                     !ctx.dry_run_option))
+          {
+            l5 ([&]{trace << "fingerprint of " << *s << " unchanged, not "
+                          << "updating " << t;});
+            rule_counters::increment (counters.fingerprint);
+          }
+          else
+          {
+            u = true;
+            update_cause (md.cause,
+                          rebuild_reason::dependency,
+                          cause_detail (*s));
+          }
+        }
+
         // Note that during a dry run we may end up with an incomplete (but
         // valid) database, but it will be updated on the next non-dry run.
         //
@@ -332,10 +537,30 @@ namespace build2
           if (pr.first)
             return *pr.first; // No need to update.
 
-          assert (md.mt == timestamp_nonexistent);
+          // The input is newer but its fingerprint is unchanged (see
+          // apply()).
+          //
+          if (md.mt != timestamp_nonexistent)
+            return target_state::unchanged;
+
           s = &pr.second;
         }
 
+        if (stats && md.cause)
+          rebuilds.record (t, *md.cause);
+
+        // Calculate the input's fingerprint before running rcc and save it
+        // once the output has been produced (see the moc rule for details).
+        //
+        optional<string> fp;
+        timestamp fp_mt;
+
+        if (fingerprint && !ctx.dry_run)
+        {
+          fp_mt = s->load_mtime ();
+          fp = qt::fingerprint (s->path (), fingerprint_kind::xml);
+        }
+
         // Prepare the rcc command line.
         //
         const process_path& pp (ctgt->process_path ());
@@ -394,22 +619,85 @@ namespace build2
                          : timestamp_unknown);
 
         if (!ctx.dry_run)
-          run (ctx, pp, args, 1 /* finish_verbosity */);
+        {
+          // Acquire the estimated amount of memory from the budget, if any,
+          // waiting for the other rcc runs to finish if necessary.
+          //
+          // If the size of the inputs is unknown (first update or invalid
+          // depdb), then assume the run will need the entire budget.
+          //
+          uint64_t me (0);
+          if (memory != nullptr)
+          {
+            me = md.bytes ? memory_estimate (*md.bytes) : memory->capacity ();
+            l5 ([&]{trace << "memory estimate " << me << " for " << t;});
+          }
+
+          budget::guard mg (memory.get (), ctx, me);
+
+          event_trace::span es (etrace.get ());
+          timestamp ts (timeline != nullptr
+                        ? system_clock::now ()
+                        : timestamp_unknown);
+
+          run_tool (ctx, pp, args, processes.get ());
+
+          if (timeline != nullptr)
+            timeline->record (t, "rcc", ts, system_clock::now ());
+
+          rule_counters::increment (counters.processes);
+          rule_counters::increment (counters.stats);
+          rule_counters::increment (counters.bytes,
+                                    event_trace::file_size (tp));
+
+          if (es)
+          {
+            event_trace::arguments ea;
+            ea ("input", s->path ().string ())
+               ("output", tp.string ())
+               ("argc", args.size () - 1)
+               ("input_size", event_trace::file_size (s->path ()))
+               ("output_size", event_trace::file_size (tp));
+
+            if (md.cause)
+              ea ("reason", reason_name (md.cause->reason));
+
+            if (memory != nullptr)
+              ea ("memory_estimate", me)
+                 ("memory_wait", mg.waited () ? "true" : "false");
+
+            es.complete ("qt.rcc",
+                         "rcc " + s->path ().leaf ().string (),
+                         move (ea));
+          }
+        }
 
         // Write the resource paths contained in the rcc-generated depfile to
         // the depdb.
         //
         if (!ctx.dry_run)
         {
+          event_trace::span es (etrace.get ());
+
           depdb dd (move (md.dd));
           size_t skip (md.skip_count);
+          size_t n (0); // Number of dependencies (for the event trace).
+
+          // Total size of the input and resource files.
+          //
+          uint64_t bytes (event_trace::file_size (s->path ()));
+          rule_counters::increment (counters.stats);
 
           // Note that fp is expected to be absolute.
           //
-          auto add = [&trace,
+          auto add = [this, &trace,
                       a, &bs, &t, pts_n = md.pts_n,
-                      &dd, &skip] (path fp)
+                      &dd, &skip, &n, &bytes] (path fp)
           {
+            ++n;
+
+            rule_counters::increment (counters.lookups);
+
             // Note that unlike prerequisites, here we don't need
             // normalize_external() since we expect the targets to be within
             // this project.
@@ -424,6 +712,9 @@ namespace build2
                    << fp.string () << "'";
             }
 
+            bytes += event_trace::file_size (fp);
+            rule_counters::increment (counters.stats);
+
             if (const build2::file* ft = find_file (
                 trace, "resource file",
                 a, bs, t,
@@ -455,6 +746,7 @@ namespace build2
             }
 
             dd.write (fp);
+            rule_counters::increment (counters.depdb_writes);
           };
 
           auto df = make_diag_frame (
@@ -516,14 +808,30 @@ namespace build2
               break;
           }
 
-          // Add the terminating blank line.
+          // Add the terminating blank line followed by the total size.
           //
           dd.expect ("");
+          counters.depdb_line (dd);
+          dd.expect (to_string (bytes));
+          counters.depdb_line (dd);
           dd.close ();
 
           md.dd.path = move (dd.path); // For mtime check below.
+
+          if (es)
+          {
+            es.complete ("qt.rcc", "depfile " + depfile.leaf ().string (),
+                         event_trace::arguments ()
+                         ("depfile", depfile.string ())
+                         ("entries", n));
+          }
         }
 
+        if (fp)
+          fingerprint_save (tp + ".f", *fp, fp_mt);
+        else if (!ctx.dry_run)
+          fingerprint_remove (tp + ".f");
+
         timestamp now (system_clock::now ());
 
         if (!ctx.dry_run)
@@ -8,6 +8,15 @@
 
 #include <libbuild2/qt/export.hxx>
 
+#include <libbuild2/qt/budget.hxx>
+#include <libbuild2/qt/change-journal.hxx>
+#include <libbuild2/qt/counters.hxx>
+#include <libbuild2/qt/lazy-import.hxx>
+#include <libbuild2/qt/event-trace.hxx>
+#include <libbuild2/qt/fingerprint.hxx>
+#include <libbuild2/qt/rebuild-log.hxx>
+#include <libbuild2/qt/timeline.hxx>
+
 namespace build2
 {
   namespace qt
@@ -20,7 +29,39 @@ namespace build2
       {
         const uint64_t version; // qt.version
         const exe*     ctgt;    // Rcc compiler target (NULL if load-only).
-        const string&  csum;    // Rcc compiler checksum.
+        const string*  csum;    // Rcc compiler checksum.
+
+        shared_ptr<event_trace> etrace; // Event trace (NULL if disabled).
+        shared_ptr<generation_timeline> timeline; // NULL if disabled.
+        bool stats = false;             // Print rule counters.
+        bool fingerprint = false;       // See config.qt.fingerprint.
+
+        // Limit on the number of Qt compiler processes in flight or NULL if
+        // unlimited (see config.qt.max_processes).
+        //
+        shared_ptr<budget> processes;
+
+        // Change journal to consult before checking the dynamic
+        // dependencies or NULL if not used (see config.qt.change_journal).
+        //
+        shared_ptr<change_journal> journal;
+
+        // Memory budget (in bytes) for concurrent rcc runs or NULL if
+        // unlimited (see config.qt.rcc.max_memory).
+        //
+        shared_ptr<budget> memory;
+
+        // Deferred compiler import or NULL if the compiler was imported when
+        // the module was loaded (see config.qt.lazy_import). If not NULL,
+        // then the compiler information above is only valid once it has
+        // been called.
+        //
+        shared_ptr<lazy_import> lazy;
+
+        // Keeps the context-wide cache of the imported compilers alive (see
+        // import_exe() in init.cxx for details).
+        //
+        shared_ptr<void> import_cache;
       };
 
       class LIBBUILD2_QT_SYMEXPORT compile_rule: public simple_rule,
@@ -41,6 +82,9 @@ namespace build2
 
         target_state
         perform_update (action, const target&, match_data&) const;
+
+        mutable rule_counters counters;
+        mutable rebuild_log   rebuilds;
       };
     }
   }
@@ -0,0 +1,111 @@
+#include <libbuild2/qt/rebuild-log.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    const char*
+    reason_name (rebuild_reason r)
+    {
+      switch (r)
+      {
+      case rebuild_reason::rule:        return "rule mismatch";
+      case rebuild_reason::compiler:    return "compiler mismatch";
+      case rebuild_reason::environment: return "environment mismatch";
+      case rebuild_reason::options:     return "options mismatch";
+      case rebuild_reason::input:       return "input mismatch";
+      case rebuild_reason::depdb:       return "no depdb";
+      case rebuild_reason::output:      return "output missing";
+      case rebuild_reason::outdated:    return "output older than depdb";
+      case rebuild_reason::dependency:  return "dependency newer than output";
+      case rebuild_reason::missing:     return "dependency missing";
+      case rebuild_reason::invalid:     return "invalid depdb entry";
+      }
+
+      return "";
+    }
+
+    string
+    cause_detail (const target& t)
+    {
+      if (const path_target* pt = t.is_a<path_target> ())
+      {
+        const path& p (pt->path ());
+
+        if (!p.empty ())
+          return p.string ();
+      }
+
+      ostringstream os;
+      os << t;
+      return os.str ();
+    }
+
+    void rebuild_log::
+    record (const target& t, const rebuild_cause& c)
+    {
+      entry e {cause_detail (t), c};
+
+      mlock l (mutex_);
+      entries_.push_back (move (e));
+    }
+
+    bool rebuild_log::
+    empty () const
+    {
+      mlock l (mutex_);
+      return entries_.empty ();
+    }
+
+    void rebuild_log::
+    print (diag_record& dr, const char* rule, const char* what)
+    {
+      vector<entry> es;
+      {
+        mlock l (mutex_);
+        es.swap (entries_);
+      }
+
+      if (es.empty ())
+        return;
+
+      // Order the entries by reason and then by target so that the output
+      // is stable regardless of the order in which the targets were updated.
+      //
+      sort (es.begin (), es.end (),
+            [] (const entry& x, const entry& y)
+            {
+              return x.cause.reason != y.cause.reason
+                ? x.cause.reason < y.cause.reason
+                : x.target < y.target;
+            });
+
+      dr << info << rule << ": " << es.size () << " target(s) " << what;
+
+      // Number of examples per reason to print unless printing everything.
+      //
+      const size_t examples (verb >= 4 ? es.size () : 3);
+
+      for (auto b (es.begin ()), i (b); i != es.end (); b = i)
+      {
+        rebuild_reason r (b->cause.reason);
+
+        for (; i != es.end () && i->cause.reason == r; ++i) ;
+
+        dr << info << "  " << reason_name (r) << ": " << (i - b);
+
+        size_t n (0);
+        for (auto j (b); j != i && n != examples; ++j, ++n)
+        {
+          dr << "\n    " << j->target;
+
+          if (!j->cause.detail.empty ())
+            dr << " (" << j->cause.detail << ')';
+        }
+
+        if (static_cast<size_t> (i - b) > n)
+          dr << "\n    ...";
+      }
+    }
+  }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/target.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Reason for updating a target (or rescanning automoc{} inputs). Only
+    // the first reason detected by a rule is recorded.
+    //
+    enum class rebuild_reason: uint8_t
+    {
+      rule,        // Rule name/version mismatch.
+      compiler,    // Compiler checksum mismatch.
+      environment, // Compiler environment checksum mismatch.
+      options,     // Options checksum mismatch.
+      input,       // Input file (or automoc{} input set) mismatch.
+      depdb,       // Dependency database does not exist.
+      output,      // Output does not exist.
+      outdated,    // Output is older than dependency database.
+      dependency,  // Static or dynamic dependency is newer than output.
+      missing,     // Dynamic dependency no longer exists.
+      invalid      // Invalid dependency database entry.
+    };
+
+    LIBBUILD2_QT_SYMEXPORT const char*
+    reason_name (rebuild_reason);
+
+    // The reason plus optional details, normally the path of the dependency
+    // that caused the update.
+    //
+    struct rebuild_cause
+    {
+      rebuild_reason reason;
+      string         detail;
+    };
+
+    // Set the cause unless already set (only the first reason is recorded).
+    //
+    inline void
+    update_cause (optional<rebuild_cause>& c,
+                  rebuild_reason r,
+                  string d = string ())
+    {
+      if (!c)
+        c = rebuild_cause {r, move (d)};
+    }
+
+    // Return the string representation of a target suitable for use as a
+    // rebuild cause detail (path for path-based targets).
+    //
+    LIBBUILD2_QT_SYMEXPORT string
+    cause_detail (const target&);
+
+    // Log of the targets updated by a rule during an operation together with
+    // their rebuild causes.
+    //
+    // The log is only maintained if requested (see config.qt.stats) and is
+    // printed as a summary table of the number of targets per reason (with
+    // a few examples) at the end of update, which helps diagnose unexpected
+    // mass regenerations. With verbosity level 4 or higher each target's
+    // record is printed.
+    //
+    class LIBBUILD2_QT_SYMEXPORT rebuild_log
+    {
+    public:
+      void
+      record (const target&, const rebuild_cause&);
+
+      bool
+      empty () const;
+
+      // Print the summary as info lines of the specified diagnostics record
+      // and clear the log. The what argument describes what happened to the
+      // targets (updated, rescanned, etc).
+      //
+      void
+      print (diag_record&, const char* rule, const char* what = "updated");
+
+    private:
+      struct entry
+      {
+        string        target;
+        rebuild_cause cause;
+      };
+
+      mutable mutex mutex_;
+      vector<entry> entries_;
+    };
+  }
+}
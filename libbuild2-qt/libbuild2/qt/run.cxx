@@ -0,0 +1,38 @@
+#include <libbuild2/qt/run.hxx>
+
+#include <libbuild2/scheduler.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    void
+    run_tool (context& ctx,
+              const process_path& pp,
+              const cstrings& args,
+              budget* processes)
+    {
+      if (processes == nullptr)
+      {
+        run (ctx, pp, args, 1 /* finish_verbosity */);
+        return;
+      }
+
+      budget::guard pg (processes, ctx, 1);
+
+      // Reactivate the thread even if the process fails.
+      //
+      struct deactivation
+      {
+        explicit
+        deactivation (context& c): ctx (c) {ctx.sched->deactivate (false);}
+        ~deactivation () {ctx.sched->activate (false);}
+
+        context& ctx;
+      } d (ctx);
+
+      run (ctx, pp, args, 1 /* finish_verbosity */);
+    }
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/context.hxx>
+
+#include <libbuild2/qt/export.hxx>
+#include <libbuild2/qt/budget.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Run a Qt compiler process and wait for its completion (see
+    // build2::run() for details).
+    //
+    // If the process limit is not NULL (see config.qt.max_processes), then
+    // first acquire one process from it and then deactivate the calling
+    // thread in the scheduler for the duration of the process execution.
+    // This allows the scheduler to use another thread for matching and
+    // compiling while we are waiting for the process (which is normally I/O
+    // bound) to complete. As a result, there can be more Qt compiler
+    // processes in flight than there are active threads, up to the limit.
+    //
+    // Otherwise, the process is run without deactivating the calling thread
+    // (as with build2::run()) so that the number of processes in flight is
+    // bounded by the number of active threads (-j).
+    //
+    LIBBUILD2_QT_SYMEXPORT void
+    run_tool (context&,
+              const process_path&,
+              const cstrings& args,
+              budget* processes);
+  }
+}
@@ -0,0 +1,219 @@
+#include <libbuild2/qt/timeline.hxx>
+
+#include <libbuild2/context.hxx>
+#include <libbuild2/scheduler.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Timelines of the projects loaded by this process (see open()).
+    //
+    static mutex timelines_mutex;
+    static map<const scope*, std::weak_ptr<generation_timeline>> timelines;
+
+    shared_ptr<generation_timeline> generation_timeline::
+    open (scope& rs)
+    {
+      mlock l (timelines_mutex);
+
+      std::weak_ptr<generation_timeline>& w (timelines[&rs]);
+
+      shared_ptr<generation_timeline> r (w.lock ());
+      if (r == nullptr)
+      {
+        r = make_shared<generation_timeline> ();
+        w = r;
+
+        auto post = [r] (action, const scope& root, const dir&)
+        {
+          if (!r->empty ())
+          {
+            diag_record dr;
+            dr << info << "qt code generation timeline for "
+               << root.out_path ();
+            r->print (dr, root.ctx.sched->max_active ());
+          }
+
+          return target_state::unchanged;
+        };
+
+        rs.operation_callbacks.emplace (
+          perform_update_id,
+          scope::operation_callback {nullptr, move (post)});
+      }
+
+      return r;
+    }
+
+    void generation_timeline::
+    record (const target& t,
+            const char* s,
+            timestamp start,
+            timestamp end,
+            const target* after)
+    {
+      context& ctx (t.ctx);
+
+      mlock l (mutex_);
+
+      // Discard the entries of the previous operation which were not
+      // printed (for example, because it was performed on a subdirectory).
+      //
+      if (mif_ != ctx.current_mif || on_ != ctx.current_on)
+      {
+        entries_.clear ();
+        mif_ = ctx.current_mif;
+        on_ = ctx.current_on;
+      }
+
+      entries_.push_back (entry {&t, after, s, start, end});
+    }
+
+    bool generation_timeline::
+    empty () const
+    {
+      mlock l (mutex_);
+      return entries_.empty ();
+    }
+
+    // Return the duration in seconds with millisecond precision.
+    //
+    static string
+    duration_string (duration d)
+    {
+      using std::chrono::milliseconds;
+      using std::chrono::duration_cast;
+
+      int64_t ms (duration_cast<milliseconds> (d).count ());
+
+      if (ms < 0)
+        ms = 0;
+
+      string r (to_string (ms / 1000));
+      r += '.';
+
+      string f (to_string (ms % 1000));
+      r.append (3 - f.size (), '0');
+      r += f;
+      r += 's';
+
+      return r;
+    }
+
+    void generation_timeline::
+    print (diag_record& dr, size_t jobs)
+    {
+      vector<entry> es;
+      {
+        mlock l (mutex_);
+        es.swap (entries_);
+      }
+
+      if (es.empty ())
+        return;
+
+      // Window, busy time, and the number of steps of each kind.
+      //
+      timestamp ws (timestamp_unknown), we (timestamp_unknown);
+      duration busy (0);
+      map<string, size_t> steps;
+
+      for (const entry& e: es)
+      {
+        if (ws == timestamp_unknown || e.start < ws) ws = e.start;
+        if (we == timestamp_unknown || e.end > we)   we = e.end;
+
+        busy += e.end - e.start;
+        ++steps[e.step];
+      }
+
+      duration window (we - ws);
+
+      // Find the step that ended last and the scan it had to wait for.
+      //
+      // Note that the scans are recorded before the runs of the group
+      // members (the runs can only start after the scan) so we look for the
+      // last entry of the predecessor target that started before the step.
+      //
+      auto find = [&es] (const target* t, timestamp before) -> const entry*
+      {
+        const entry* r (nullptr);
+        for (const entry& e: es)
+        {
+          if (e.key == t && e.start <= before && (r == nullptr ||
+                                                  e.start > r->start))
+            r = &e;
+        }
+        return r;
+      };
+
+      const entry* last (&es.front ());
+      for (const entry& e: es)
+      {
+        if (e.end > last->end)
+          last = &e;
+      }
+
+      vector<const entry*> chain {last};
+      for (const entry* e (last); e->after != nullptr; )
+      {
+        if ((e = find (e->after, e->start)) == nullptr)
+          break;
+
+        chain.insert (chain.begin (), e);
+      }
+
+      duration work (0);
+      for (const entry* e: chain)
+        work += e->end - e->start;
+
+      duration path (chain.back ()->end - chain.front ()->start);
+
+      auto at = [ws] (timestamp t) {return duration_string (t - ws);};
+
+      dr << info << "  steps:";
+      {
+        bool f (true);
+        for (const pair<const string, size_t>& p: steps)
+        {
+          dr << (f ? " " : ", ") << p.first << ' ' << p.second;
+          f = false;
+        }
+      }
+
+      dr << info << "  generation window: " << duration_string (window);
+
+      // Average parallelism with one decimal digit.
+      //
+      {
+        uint64_t w (static_cast<uint64_t> (window.count ()));
+        uint64_t p (w != 0
+                    ? static_cast<uint64_t> (busy.count ()) * 10 / w
+                    : 10);
+
+        dr << info << "  generation time: " << duration_string (busy)
+           << ", average parallelism " << p / 10 << '.' << p % 10
+           << " of " << jobs << " job(s)";
+      }
+
+      {
+        duration total (window * static_cast<duration::rep> (jobs));
+        dr << info << "  other job time within window: "
+           << duration_string (total > busy ? total - busy : duration (0));
+      }
+
+      dr << info << "  latest-finishing step: " << duration_string (path)
+         << " ending at " << at (last->end)
+         << " (work " << duration_string (work) << ", waiting "
+         << duration_string (path > work ? path - work : duration (0)) << ')';
+
+      for (const entry* e: chain)
+      {
+        dr << "\n    " << e->step << ' ' << *e->key << ": "
+           << at (e->start) << " to " << at (e->end)
+           << " (" << duration_string (e->end - e->start) << ')';
+      }
+    }
+  }
+}
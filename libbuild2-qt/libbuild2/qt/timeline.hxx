@@ -0,0 +1,97 @@
+#pragma once
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/scope.hxx>
+#include <libbuild2/target.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/qt/export.hxx>
+
+namespace build2
+{
+  namespace qt
+  {
+    // Timeline of the Qt code generation (automoc{} scans and moc, rcc, and
+    // uic runs) during an update used to report its latest-finishing step
+    // and parallelism.
+    //
+    // The timeline is enabled with the config.qt.timeline variable and
+    // is shared by all the qt modules of a project. It is printed at the end
+    // of update (see print() for details).
+    //
+    // Note that the steps are recorded during both match (automoc{} scans
+    // and the generators updated during match) and execute. As a result, the
+    // timeline is not reset with an operation callback (which is only called
+    // at the beginning of execute) but rather on the first step recorded
+    // during a new operation.
+    //
+    class LIBBUILD2_QT_SYMEXPORT generation_timeline
+    {
+    public:
+      // Return the timeline of the project, creating it and registering the
+      // root scope operation callback that prints it if it does not exist
+      // yet.
+      //
+      static shared_ptr<generation_timeline>
+      open (scope& rs);
+
+      generation_timeline () = default;
+
+      generation_timeline (const generation_timeline&) = delete;
+      generation_timeline& operator= (const generation_timeline&) = delete;
+
+      // Record the generation step for the specified target (automoc{} group
+      // for scans and output for runs). If the step could only start after
+      // another recorded step (a moc run of an automoc{} member after the
+      // group scan), then pass that step's target as after.
+      //
+      void
+      record (const target&,
+              const char* step,           // automoc, moc, rcc, or uic.
+              timestamp start,
+              timestamp end,
+              const target* after = nullptr);
+
+      bool
+      empty () const;
+
+      // Print the summary as info lines of the specified diagnostics record
+      // and clear the timeline. Do nothing if the timeline is empty.
+      //
+      // The summary includes the window during which code generation was in
+      // progress (the times are relative to its beginning), the average
+      // generation parallelism achieved within this window, the job time
+      // within this window that was spent on something other than code
+      // generation (for example, compiling C++ sources), and the
+      // latest-finishing step along with the automoc{} scan it had to wait
+      // for, if any. Since the C++ compilations that depend on generated
+      // outputs cannot start before their outputs are produced, the end of
+      // this step is the earliest time the last of them can start. Note that
+      // the dependencies of the generators on other targets (and of the
+      // compilations on the generators) are not recorded.
+      //
+      void
+      print (diag_record&, size_t jobs);
+
+    private:
+      struct entry
+      {
+        const target* key;
+        const target* after;
+        const char*   step;
+        timestamp     start;
+        timestamp     end;
+      };
+
+      mutable mutex mutex_;
+      vector<entry> entries_;
+
+      // The operation during which the entries were recorded.
+      //
+      const meta_operation_info* mif_ = nullptr;
+      size_t on_ = 0;
+    };
+  }
+}
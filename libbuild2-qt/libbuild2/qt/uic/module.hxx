@@ -19,6 +19,11 @@ namespace build2
       {
       public:
         explicit module (data&& d): data (move (d)), compile_rule (move (d)) {}
+
+        // Printer of the rule statistics (see register_statistics() in
+        // init.cxx). Note: must be destroyed before the rules.
+        //
+        shared_ptr<void> statistics;
       };
     }
   }
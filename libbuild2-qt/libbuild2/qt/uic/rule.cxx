@@ -4,6 +4,8 @@
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/diagnostics.hxx>
 
+#include <libbuild2/qt/run.hxx>
+
 #include <libbuild2/qt/uic/target.hxx>
 
 namespace build2
@@ -49,8 +51,12 @@ namespace build2
         //
         match_prerequisite_members (a, t);
 
-        // For update inject dependency on the uic compiler target.
+        // For update inject dependency on the uic compiler target (importing
+        // it first if the import was deferred).
         //
+        if (a == perform_update_id && lazy != nullptr)
+          (*lazy) (t.ctx);
+
         if (a == perform_update_id && ctgt != nullptr)
           inject (a, t, *ctgt);
 
@@ -60,7 +66,10 @@ namespace build2
           {
             return perform_update (a, t);
           };
-        case perform_clean_id:  return &perform_clean_depdb;
+        case perform_clean_id:  return [] (action a, const target& t)
+          {
+            return perform_clean_extra (a, t.as<file> (), {".d", ".f"});
+          };
         default:                return noop_recipe; // Configure/dist update.
         }
       }
@@ -82,6 +91,7 @@ namespace build2
         // Update prerequisites and determine if any render us out-of-date.
         //
         timestamp mt (t.load_mtime ());
+        rule_counters::increment (counters.stats);
         auto pr (execute_prerequisites<ui> (a, t, mt));
 
         bool update (!pr.first);
@@ -92,17 +102,27 @@ namespace build2
         // We use depdb to track changes to the .ui file name, options,
         // compiler, etc.
         //
+        optional<rebuild_cause> cause;
+
         depdb dd (tp + ".d");
         {
           // First should come the rule name/version.
           //
           if (dd.expect ("qt.uic.compile 1") != nullptr)
+          {
             l4 ([&]{trace << "rule mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::rule);
+          }
+          counters.depdb_line (dd);
 
           // Then the compiler checksum.
           //
-          if (dd.expect (csum) != nullptr)
+          if (dd.expect (*csum) != nullptr)
+          {
             l4 ([&]{trace << "compiler mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::compiler);
+          }
+          counters.depdb_line (dd);
 
           // Then the options checksum.
           //
@@ -111,25 +131,95 @@ namespace build2
             append_options (cs, t, "qt.uic.options");
 
             if (dd.expect (cs.string ()) != nullptr)
+            {
               l4 ([&]{trace << "options mismatch forcing update of " << t;});
+              update_cause (cause, rebuild_reason::options);
+            }
+            counters.depdb_line (dd);
           }
 
           // Finally the .ui input file.
           //
           if (dd.expect (s.path ()) != nullptr)
+          {
             l4 ([&]{trace << "input file mismatch forcing update of " << t;});
+            update_cause (cause, rebuild_reason::input, s.path ().string ());
+          }
+          counters.depdb_line (dd);
         }
 
         // Update if depdb mismatch.
         //
         if (dd.writing () || dd.mtime > mt)
           update = true;
+        else if (update && fingerprint && mt != timestamp_nonexistent)
+        {
+          // If fingerprints are enabled and only the .ui input is newer
+          // than the output, then only update if its fingerprint has
+          // changed as well (see the moc rule for details).
+          //
+          bool only (s.load_mtime () > mt);
+
+          for (const prerequisite_target& p: t.prerequisite_targets[a])
+          {
+            if (!only)
+              break;
+
+            if (p.target != nullptr && p.target != &s)
+            {
+              if (const mtime_target* m = p.target->is_a<mtime_target> ())
+                only = m->load_mtime () <= mt;
+            }
+          }
+
+          if (only && fingerprint_unchanged (tp + ".f",
+                                             s.path (), s.load_mtime (),
+                                             fingerprint_kind::xml,
+                                             !ctx.dry_run_option))
+          {
+            l5 ([&]{trace << "fingerprint of " << s << " unchanged, not "
+                          << "updating " << t;});
+            rule_counters::increment (counters.fingerprint);
+
+            update = false;
+            ts = target_state::unchanged;
+          }
+        }
+
+        // Note that execute_prerequisites() doesn't tell us which
+        // prerequisite is newer.
+        //
+        if (update)
+        {
+          using r = rebuild_reason;
+
+          update_cause (cause,
+                        (dd.writing ()               ? r::depdb      :
+                         mt == timestamp_nonexistent ? r::output     :
+                         !pr.first                   ? r::dependency :
+                         r::outdated));
+        }
 
         dd.close ();
 
         if (!update)
           return ts;
 
+        if (stats && cause)
+          rebuilds.record (t, *cause);
+
+        // Calculate the input's fingerprint before running uic and save it
+        // once the output has been produced (see the moc rule for details).
+        //
+        optional<string> fp;
+        timestamp fp_mt;
+
+        if (fingerprint && !ctx.dry_run)
+        {
+          fp_mt = s.load_mtime ();
+          fp = qt::fingerprint (s.path (), fingerprint_kind::xml);
+        }
+
         // Translate paths to relative (to working directory). This results in
         // easier to read diagnostics.
         //
@@ -154,10 +244,46 @@ namespace build2
 
         if (!ctx.dry_run)
         {
-          run (ctx, pp, args, 1 /* finish_verbosity */);
+          event_trace::span es (etrace.get ());
+          timestamp ts (timeline != nullptr
+                        ? system_clock::now ()
+                        : timestamp_unknown);
+
+          run_tool (ctx, pp, args, processes.get ());
+
+          if (timeline != nullptr)
+            timeline->record (t, "uic", ts, system_clock::now ());
+
+          rule_counters::increment (counters.processes);
+          rule_counters::increment (counters.stats);
+          rule_counters::increment (counters.bytes,
+                                    event_trace::file_size (tp));
+
+          if (es)
+          {
+            event_trace::arguments ea;
+            ea ("input", s.path ().string ())
+               ("output", tp.string ())
+               ("argc", args.size () - 1)
+               ("input_size", event_trace::file_size (s.path ()))
+               ("output_size", event_trace::file_size (tp));
+
+            if (cause)
+              ea ("reason", reason_name (cause->reason));
+
+            es.complete ("qt.uic",
+                         "uic " + s.path ().leaf ().string (),
+                         move (ea));
+          }
+
           dd.check_mtime (tp);
         }
 
+        if (fp)
+          fingerprint_save (tp + ".f", *fp, fp_mt);
+        else if (!ctx.dry_run)
+          fingerprint_remove (tp + ".f");
+
         t.mtime (system_clock::now ());
         return target_state::changed;
       }